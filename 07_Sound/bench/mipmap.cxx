@@ -0,0 +1,132 @@
+// Mpixels/s of generate_mips on noise textures, then ms per frame of
+// quads drawn at 1/20 size of 2048x2048 texture with and without mips,
+// on engine created with config given as argument, gl=egl by default
+#include "engine.hxx"
+#include "lodepng.h"
+#include "mipmap.hxx"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+template <typename function>
+static double best_seconds(function f, int runs) {
+  double best = 1e9;
+  for (int run = 0; run < runs; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, time.count());
+  }
+  return best;
+}
+
+static std::vector<unsigned char> make_noise(std::uint32_t width,
+                                             std::uint32_t height,
+                                             std::size_t bytes) {
+  std::vector<unsigned char> rgba(bytes, 0);
+  std::uint32_t state = 1;
+  for (std::size_t i = 0; i < std::size_t{4} * width * height; ++i) {
+    state = state * 1664525u + 1013904223u;
+    rgba[i] = static_cast<unsigned char>(state >> 24);
+  }
+  return rgba;
+}
+
+static void bench_generate_mips() {
+  for (const std::uint32_t size : {256u, 2048u}) {
+    const std::uint32_t levels = tme::mip_levels(size, size);
+    std::vector<unsigned char> chain =
+        make_noise(size, size, tme::mip_chain_size(size, size, levels));
+    const double seconds = best_seconds(
+        [&] { tme::generate_mips(chain.data(), size, size, levels); },
+        size < 1024 ? 200 : 8);
+    std::printf("generate_mips %4ux%-4u %8.2f ms %8.1f Mpixels/s of level 0\n",
+                size, size, seconds * 1e3,
+                static_cast<double>(size) * size / seconds / 1e6);
+  }
+}
+
+static tme::v2 vertex(float x, float y, float u, float v) {
+  tme::v2 result;
+  result.pos = tme::vec2(x, y);
+  result.uv = tme::vec2(u, v);
+  result.c = tme::color(1.f, 1.f, 1.f, 1.f);
+  return result;
+}
+
+static void bench_minified_draw(tme::engine &e, const std::string &png) {
+  const int frames = 40;
+  const int quads = 400;
+  const float scale = 1.f / 20.f;
+  tme::quad2 q;
+  q.v[0] = vertex(-1.f, -1.f, 0.f, 1.f);
+  q.v[1] = vertex(1.f, -1.f, 1.f, 1.f);
+  q.v[2] = vertex(1.f, 1.f, 1.f, 0.f);
+  q.v[3] = vertex(-1.f, 1.f, 0.f, 0.f);
+
+  for (const bool linear : {false, true}) {
+    for (const bool mipmaps : {false, true}) {
+      tme::texture_options options;
+      if (linear) {
+        options.min_filter = tme::texture_filter::linear;
+        options.mag_filter = tme::texture_filter::linear;
+      }
+      options.mipmaps = mipmaps;
+      tme::texture *t = e.create_texture(png, options);
+      std::vector<unsigned char> pixels;
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+      const auto draw = [&] {
+        for (int frame = 0; frame < frames; ++frame) {
+          e.begin_batch();
+          for (int i = 0; i < quads; ++i) {
+            const float x = -1.f + 0.02f * static_cast<float>(i * 37 % 100);
+            const float y = -1.f + 0.02f * static_cast<float>(i * 53 % 97);
+            e.submit(q, t,
+                     tme::mat3x2::scale(scale) *
+                         tme::mat3x2::rotation(0.01f * i) *
+                         tme::mat3x2::movement(tme::vec2(x, y)));
+          }
+          e.flush_batch();
+          e.swap_buffers();
+        }
+        // waits for gpu to finish frames
+        e.read_pixels(pixels, width, height);
+      };
+      draw();
+      const double seconds = best_seconds(draw, 3);
+      std::printf("%-7s %-10s %6d quads at 1/20 %8.2f ms/frame\n",
+                  linear ? "linear" : "nearest",
+                  mipmaps ? "mipmaps" : "no mipmaps", quads,
+                  seconds * 1e3 / frames);
+      e.destroy_texture(t);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bench_generate_mips();
+
+  const std::uint32_t size = 2048;
+  const std::string png = "bench_mipmap.png";
+  if (lodepng::encode(png, make_noise(size, size, std::size_t{4} * size * size),
+                      size, size) != 0) {
+    std::fprintf(stderr, "can't write %s\n", png.c_str());
+    return EXIT_FAILURE;
+  }
+  std::unique_ptr<tme::engine, void (*)(tme::engine *)> engine(
+      tme::create_engine(), tme::destroy_engine);
+  const std::string error = engine->initialize(argc > 1 ? argv[1] : "gl=egl");
+  if (!error.empty()) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  bench_minified_draw(*engine, png);
+  engine->uninitialize();
+  return 0;
+}
@@ -0,0 +1,192 @@
+// MB/s of decoded rgba for lodepng of libengine against lodepng before
+// table driven inflate and sse2 unfilter (lodepng_old in build directory,
+// see CMakeLists.txt), on generated sprites and on png files given as
+// arguments, e.g. tank.png; both decoders must give the same pixels
+#include "lodepng.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace lodepng_old {
+unsigned lodepng_decode32(unsigned char **out, unsigned *w, unsigned *h,
+                          const unsigned char *in, std::size_t insize);
+} // namespace lodepng_old
+
+using decode_function = unsigned (*)(unsigned char **, unsigned *,
+                                     unsigned *, const unsigned char *,
+                                     std::size_t);
+
+struct corpus {
+  std::string name;
+  std::vector<std::vector<unsigned char>> files;
+  std::size_t rgba_bytes = 0;
+};
+
+static std::uint32_t next_random(std::uint32_t &state) {
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+// sprite on transparent background: flat - few colors like pixel art,
+// shaded - smooth gradients, noisy - gradients with per pixel noise
+static std::vector<unsigned char> make_sprite(std::uint32_t size,
+                                              const std::string &kind,
+                                              std::uint32_t seed) {
+  std::vector<unsigned char> rgba(std::size_t{4} * size * size, 0);
+  std::uint32_t state = seed;
+  const float half = 0.5f * static_cast<float>(size);
+  const unsigned char palette[4][3] = {
+      {200, 40, 40}, {40, 160, 60}, {230, 210, 90}, {30, 30, 60}};
+  for (std::uint32_t y = 0; y < size; ++y) {
+    for (std::uint32_t x = 0; x < size; ++x) {
+      const float dx = (static_cast<float>(x) - half) / half;
+      const float dy = (static_cast<float>(y) - half) / half;
+      const float r2 = dx * dx + dy * dy;
+      if (r2 > 0.9f) {
+        continue;
+      }
+      unsigned char *p = &rgba[4 * (std::size_t{size} * y + x)];
+      if (kind == "flat") {
+        const unsigned char *c = palette[(x * 4 / size + (y * 4 / size) +
+                                          (r2 > 0.7f ? 3 : 0)) %
+                                         4];
+        p[0] = c[0];
+        p[1] = c[1];
+        p[2] = c[2];
+        p[3] = 255;
+        continue;
+      }
+      const float shade = 1.f - r2;
+      float noise = 0.f;
+      if (kind == "noisy") {
+        noise = static_cast<float>(next_random(state) % 64) - 32.f;
+      }
+      const auto channel = [&](float v) {
+        return static_cast<unsigned char>(
+            std::min(255.f, std::max(0.f, v * shade + noise)));
+      };
+      p[0] = channel(250.f * (0.5f + 0.5f * dx));
+      p[1] = channel(250.f * (0.5f + 0.5f * dy));
+      p[2] = channel(180.f);
+      p[3] = static_cast<unsigned char>(std::min(255.f, 400.f * shade));
+    }
+  }
+  return rgba;
+}
+
+static corpus make_sprites(const std::string &kind) {
+  corpus result;
+  result.name = kind + " sprites";
+  std::uint32_t seed = 1;
+  for (const std::uint32_t size : {32u, 64u, 128u, 256u, 512u}) {
+    // about same pixel count of every size
+    const std::uint32_t count = std::max(1u, 512u * 512u / (size * size) / 4);
+    for (std::uint32_t i = 0; i < count; ++i) {
+      std::vector<unsigned char> png;
+      const unsigned error =
+          lodepng::encode(png, make_sprite(size, kind, seed++), size, size);
+      if (error != 0) {
+        std::fprintf(stderr, "encode: %s\n", lodepng_error_text(error));
+        std::exit(EXIT_FAILURE);
+      }
+      result.files.push_back(std::move(png));
+      result.rgba_bytes += std::size_t{4} * size * size;
+    }
+  }
+  return result;
+}
+
+static bool decode_all(decode_function decode, const corpus &c) {
+  for (const std::vector<unsigned char> &file : c.files) {
+    unsigned char *rgba = nullptr;
+    unsigned w = 0;
+    unsigned h = 0;
+    const unsigned error = decode(&rgba, &w, &h, file.data(), file.size());
+    std::free(rgba);
+    if (error != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool same_pixels(const corpus &c) {
+  for (const std::vector<unsigned char> &file : c.files) {
+    unsigned char *pixels[2] = {nullptr, nullptr};
+    unsigned w[2] = {0, 0};
+    unsigned h[2] = {0, 0};
+    const unsigned error_old = lodepng_old::lodepng_decode32(
+        &pixels[0], &w[0], &h[0], file.data(), file.size());
+    const unsigned error_new = lodepng_decode32(&pixels[1], &w[1], &h[1],
+                                                file.data(), file.size());
+    const bool same =
+        error_old == error_new && w[0] == w[1] && h[0] == h[1] &&
+        (error_old != 0 ||
+         std::equal(pixels[0], pixels[0] + std::size_t{4} * w[0] * h[0],
+                    pixels[1]));
+    std::free(pixels[0]);
+    std::free(pixels[1]);
+    if (!same) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static double best_mb_per_second(decode_function decode, const corpus &c) {
+  double best = 1e9;
+  // at least 5 runs and about a second
+  double total = 0.;
+  for (int run = 0; run < 5 || total < 1.; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!decode_all(decode, c)) {
+      std::fprintf(stderr, "%s: decode failed\n", c.name.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    const std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, time.count());
+    total += time.count();
+  }
+  return static_cast<double>(c.rgba_bytes) / best / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<corpus> corpora = {make_sprites("flat"), make_sprites("shaded"),
+                                 make_sprites("noisy")};
+  for (int i = 1; i < argc; ++i) {
+    corpus file;
+    file.name = argv[i];
+    std::vector<unsigned char> png;
+    std::vector<unsigned char> rgba;
+    unsigned w = 0;
+    unsigned h = 0;
+    if (lodepng::load_file(png, argv[i]) != 0 ||
+        lodepng::decode(rgba, w, h, png) != 0) {
+      std::fprintf(stderr, "can't read %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    file.files.push_back(std::move(png));
+    file.rgba_bytes = rgba.size();
+    corpora.push_back(std::move(file));
+  }
+
+  std::printf("%-24s %6s %8s %10s %10s %8s\n", "corpus", "files", "MB",
+              "old MB/s", "new MB/s", "speedup");
+  for (const corpus &c : corpora) {
+    if (!same_pixels(c)) {
+      std::fprintf(stderr, "%s: decoders differ\n", c.name.c_str());
+      return EXIT_FAILURE;
+    }
+    const double old_speed =
+        best_mb_per_second(lodepng_old::lodepng_decode32, c);
+    const double new_speed = best_mb_per_second(lodepng_decode32, c);
+    std::printf("%-24s %6zu %8.2f %10.1f %10.1f %7.2fx\n", c.name.c_str(),
+                c.files.size(), c.rgba_bytes / 1e6, old_speed, new_speed,
+                new_speed / old_speed);
+  }
+  return 0;
+}
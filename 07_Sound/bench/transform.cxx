@@ -0,0 +1,75 @@
+// vertices per second of per-vertex v * m loops against bulk transform of
+// vec2 and tri2 arrays, for cache sized and memory sized arrays
+#include "engine.hxx"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+template <typename function>
+static double best_seconds(function f, int runs) {
+  double best = 1e9;
+  for (int run = 0; run < runs; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, time.count());
+  }
+  return best;
+}
+
+static void report(const char *name, std::size_t vertices, double seconds) {
+  std::printf("%-28s %9zu vertices %8.1f M vertices/s\n", name, vertices,
+              vertices / seconds / 1e6);
+}
+
+int main() {
+  const tme::mat3x2 m =
+      tme::mat3x2::rotation(0.3f) * tme::mat3x2::movement(tme::vec2(1, 2));
+  for (const std::size_t count : {std::size_t{3 << 10}, std::size_t{3 << 20}}) {
+    const int runs = count < 100000 ? 2000 : 20;
+    std::vector<tme::vec2> in(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      in[i] = tme::vec2(0.001f * i, 1.f - 0.002f * i);
+    }
+    std::vector<tme::vec2> out(count);
+
+    const auto loop = [&] {
+      for (std::size_t i = 0; i < count; ++i) {
+        out[i] = in[i] * m;
+      }
+    };
+    report("v * m loop", count, best_seconds(loop, runs));
+    const auto bulk = [&] { tme::transform(in.data(), out.data(), count, m); };
+    report("transform vec2", count, best_seconds(bulk, runs));
+
+    std::vector<tme::tri2> triangles(count / 3);
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+      for (std::size_t k = 0; k < 3; ++k) {
+        triangles[i].v[k].pos = in[3 * i + k];
+      }
+    }
+    std::vector<tme::tri2> transformed(triangles.size());
+    // what games did before bulk transform, as in 06_Matrices
+    const auto loop_triangles = [&] {
+      for (std::size_t i = 0; i < triangles.size(); ++i) {
+        tme::tri2 &t = transformed[i];
+        for (std::size_t k = 0; k < 3; ++k) {
+          t.v[k] = triangles[i].v[k];
+          t.v[k].pos = t.v[k].pos * m;
+        }
+      }
+    };
+    report("tri2 pos * m loop", count, best_seconds(loop_triangles, runs));
+    const auto bulk_triangles = [&] {
+      tme::transform(triangles.data(), transformed.data(), triangles.size(),
+                     m);
+    };
+    report("transform tri2", count, best_seconds(bulk_triangles, runs));
+    // checksum keeps compiler from dropping loops
+    std::printf("check %f %f\n", out[count - 1].x,
+                transformed.back().v[2].pos.y);
+  }
+  return 0;
+}
@@ -34,6 +34,11 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LODEPNG_SSE2
+#include <emmintrin.h>
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -60,19 +65,39 @@ lodepng source code. Don't forget to remove "static" if you copypaste them
 from here.*/
 
 #ifdef LODEPNG_COMPILE_ALLOCATORS
+#if defined(_MSC_VER)
+#define LODEPNG_THREAD_LOCAL __declspec(thread)
+#elif defined(__cplusplus) && __cplusplus >= 201103L
+#define LODEPNG_THREAD_LOCAL thread_local
+#else
+#define LODEPNG_THREAD_LOCAL __thread
+#endif
+
+/*set by lodepng_set_thread_allocator, malloc_func is NULL for the C functions*/
+static LODEPNG_THREAD_LOCAL LodePNGAllocator lodepng_allocator;
+
+void lodepng_set_thread_allocator(const LodePNGAllocator* allocator)
+{
+  if(allocator) lodepng_allocator = *allocator;
+  else lodepng_allocator.malloc_func = 0;
+}
+
 static void* lodepng_malloc(size_t size)
 {
+  if(lodepng_allocator.malloc_func) return lodepng_allocator.malloc_func(lodepng_allocator.context, size);
   return malloc(size);
 }
 
 static void* lodepng_realloc(void* ptr, size_t new_size)
 {
+  if(lodepng_allocator.malloc_func) return lodepng_allocator.realloc_func(lodepng_allocator.context, ptr, new_size);
   return realloc(ptr, new_size);
 }
 
 static void lodepng_free(void* ptr)
 {
-  free(ptr);
+  if(lodepng_allocator.malloc_func) lodepng_allocator.free_func(lodepng_allocator.context, ptr);
+  else free(ptr);
 }
 #else /*LODEPNG_COMPILE_ALLOCATORS*/
 void* lodepng_malloc(size_t size);
@@ -461,6 +486,38 @@ static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bits
   }
   return result;
 }
+
+/*
+at least the next 56 bits starting at bitpointer, in one read of 8 bytes.
+Bytes past inlength read as 0, the caller checks the bit pointer after consuming bits.
+*/
+static unsigned long long peekBits(size_t bitpointer, const unsigned char* bitstream, size_t inlength)
+{
+  size_t p = bitpointer >> 3, i;
+  unsigned long long result = 0;
+  if(p + 8 <= inlength)
+  {
+    /*compilers turn this into a single unaligned load on little endian machines*/
+    const unsigned char* b = bitstream + p;
+    result = (unsigned long long)b[0] | ((unsigned long long)b[1] << 8u) | ((unsigned long long)b[2] << 16u) |
+             ((unsigned long long)b[3] << 24u) | ((unsigned long long)b[4] << 32u) |
+             ((unsigned long long)b[5] << 40u) | ((unsigned long long)b[6] << 48u) |
+             ((unsigned long long)b[7] << 56u);
+  }
+  else
+  {
+    for(i = 0; p + i < inlength; ++i) result |= (unsigned long long)bitstream[p + i] << (8u * i);
+  }
+  return result >> (bitpointer & 7u);
+}
+
+/*same as readBitsFromStream for nbits <= 32, the caller has checked the bit pointer against inlength*/
+static unsigned readBitsFast(size_t* bitpointer, const unsigned char* bitstream, size_t nbits, size_t inlength)
+{
+  unsigned result = (unsigned)(peekBits(*bitpointer, bitstream, inlength) & ((1ull << nbits) - 1u));
+  *bitpointer += nbits;
+  return result;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -513,6 +570,10 @@ typedef struct HuffmanTree
   unsigned* lengths; /*the lengths of the codes of the 1d-tree*/
   unsigned maxbitlen; /*maximum number of bits a single code can get*/
   unsigned numcodes; /*number of symbols in the alphabet = number of codes*/
+  /*decoder lookup table indexed by the next headbits input bits, see HuffmanTree_makeTable*/
+  unsigned headbits;
+  unsigned char* table_len;
+  unsigned short* table_value;
 } HuffmanTree;
 
 /*function used for debug purposes to draw the tree in ascii art with C++*/
@@ -533,6 +594,8 @@ static void HuffmanTree_init(HuffmanTree* tree)
   tree->tree2d = 0;
   tree->tree1d = 0;
   tree->lengths = 0;
+  tree->table_len = 0;
+  tree->table_value = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree)
@@ -540,8 +603,135 @@ static void HuffmanTree_cleanup(HuffmanTree* tree)
   lodepng_free(tree->tree2d);
   lodepng_free(tree->tree1d);
   lodepng_free(tree->lengths);
+  lodepng_free(tree->table_len);
+  lodepng_free(tree->table_value);
+}
+
+#ifdef LODEPNG_COMPILE_DECODER
+/*codes up to headbits long are decoded with one table lookup, longer ones with a second lookup in a
+subtable; headbits is the longest code length, at most FIRSTBITS, so small trees get small tables*/
+#define FIRSTBITS 9u
+/*head entry length of codes longer than 15 bits, which only corrupted code lengths give: value is the
+position in tree2d after headbits bits, the rest is walked bit by bit*/
+#define DEEPCODE 255u
+
+/*number of bits below this internal node of tree2d to its deepest code*/
+static unsigned HuffmanTree_depth(const HuffmanTree* tree, unsigned treepos)
+{
+  unsigned bit, result = 1;
+  for(bit = 0; bit != 2; ++bit)
+  {
+    unsigned ct = tree->tree2d[2 * treepos + bit];
+    if(ct >= tree->numcodes)
+    {
+      unsigned depth = 1 + HuffmanTree_depth(tree, ct - tree->numcodes);
+      if(depth > result) result = depth;
+    }
+  }
+  return result;
 }
 
+/*
+fills table of 2^bits entries for codes below treepos, whose first depth bits are prefix.
+A code of l bits fills every entry starting with it, with length base + l, so the table is
+made in one walk of the tree instead of one walk per entry, which dominated decoding of
+small images. Unused codes of incomplete trees are 0 in tree2d, so they give symbol 0, like
+when decoding bit by bit. Entries of codes longer than bits get length 0 and the position
+in tree2d after their first bits in subpos.
+*/
+static void HuffmanTree_fillTable(const HuffmanTree* tree, unsigned treepos, unsigned depth, unsigned prefix,
+                                  unsigned bits, unsigned base,
+                                  unsigned char* len, unsigned short* value, unsigned* subpos)
+{
+  unsigned bit, i;
+  for(bit = 0; bit != 2; ++bit)
+  {
+    unsigned ct = tree->tree2d[2 * treepos + bit];
+    unsigned code = prefix | (bit << depth);
+    if(ct < tree->numcodes)
+    {
+      for(i = code; i < (1u << bits); i += 1u << (depth + 1))
+      {
+        len[i] = (unsigned char)(base + depth + 1);
+        value[i] = (unsigned short)ct;
+      }
+    }
+    else if(depth + 1 != bits)
+    {
+      HuffmanTree_fillTable(tree, ct - tree->numcodes, depth + 1, code, bits, base, len, value, subpos);
+    }
+    else
+    {
+      len[code] = 0;
+      subpos[code] = ct - tree->numcodes;
+    }
+  }
+}
+
+/*
+lookup table for huffmanDecodeSymbol, built from tree2d so it decodes exactly like
+walking tree2d bit by bit, also for incomplete trees. Deflate stores codes starting
+with their most significant bit, so the next input bits are the table index as is.
+Head entries with a length above headbits point to a subtable for the bits after
+headbits, the length is headbits + index bits of that subtable, or DEEPCODE.
+*/
+static unsigned HuffmanTree_makeTable(HuffmanTree* tree)
+{
+  unsigned i, headsize, size, pointer;
+  unsigned subbits[1u << FIRSTBITS];
+  unsigned char headlen[1u << FIRSTBITS];
+  unsigned short headvalue[1u << FIRSTBITS];
+  unsigned subpos[1u << FIRSTBITS];
+
+  tree->headbits = 1;
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    if(tree->lengths[i] > tree->headbits) tree->headbits = tree->lengths[i];
+  }
+  if(tree->headbits > FIRSTBITS) tree->headbits = FIRSTBITS;
+  headsize = 1u << tree->headbits;
+
+  HuffmanTree_fillTable(tree, 0, 0, 0, tree->headbits, 0, headlen, headvalue, subpos);
+  size = headsize;
+  for(i = 0; i != headsize; ++i)
+  {
+    subbits[i] = 0;
+    if(headlen[i]) continue;
+    subbits[i] = HuffmanTree_depth(tree, subpos[i]);
+    if(tree->headbits + subbits[i] > 15) subbits[i] = 0; /*DEEPCODE, no subtable*/
+    else size += 1u << subbits[i];
+  }
+
+  tree->table_len = (unsigned char*)lodepng_malloc(size * sizeof(*tree->table_len));
+  tree->table_value = (unsigned short*)lodepng_malloc(size * sizeof(*tree->table_value));
+  if(!tree->table_len || !tree->table_value) return 83; /*alloc fail*/
+
+  pointer = headsize;
+  for(i = 0; i != headsize; ++i)
+  {
+    if(headlen[i])
+    {
+      tree->table_len[i] = headlen[i];
+      tree->table_value[i] = headvalue[i];
+      continue;
+    }
+    if(!subbits[i])
+    {
+      tree->table_len[i] = (unsigned char)DEEPCODE;
+      tree->table_value[i] = (unsigned short)subpos[i];
+      continue;
+    }
+    tree->table_len[i] = (unsigned char)(tree->headbits + subbits[i]);
+    tree->table_value[i] = (unsigned short)pointer;
+    /*subtable covers the deepest code below subpos[i], so all its entries end on a symbol*/
+    HuffmanTree_fillTable(tree, subpos[i], 0, 0, subbits[i], tree->headbits,
+                          tree->table_len + pointer, tree->table_value + pointer, subpos);
+    pointer += 1u << subbits[i];
+  }
+  return 0;
+}
+#endif /*LODEPNG_COMPILE_DECODER*/
+
 /*the tree representation used by the decoder. return value is error*/
 static unsigned HuffmanTree_make2DTree(HuffmanTree* tree)
 {
@@ -644,8 +834,11 @@ static unsigned HuffmanTree_makeFromLengths2(HuffmanTree* tree)
   uivector_cleanup(&blcount);
   uivector_cleanup(&nextcode);
 
-  if(!error) return HuffmanTree_make2DTree(tree);
-  else return error;
+  if(!error) error = HuffmanTree_make2DTree(tree);
+#ifdef LODEPNG_COMPILE_DECODER
+  if(!error) error = HuffmanTree_makeTable(tree);
+#endif /*LODEPNG_COMPILE_DECODER*/
+  return error;
 }
 
 /*
@@ -940,6 +1133,28 @@ static unsigned generateFixedDistanceTree(HuffmanTree* tree)
 
 #ifdef LODEPNG_COMPILE_DECODER
 
+/*rest of DEEPCODE code from treepos, bit by bit like decoding did before the tables*/
+static unsigned huffmanDecodeDeep(const unsigned char* in, size_t* bp,
+                                  const HuffmanTree* codetree, size_t inbitlength, unsigned treepos)
+{
+  unsigned ct;
+  if(*bp + codetree->headbits > inbitlength)
+  {
+    *bp = inbitlength;
+    return (unsigned)(-1); /*error: end of input memory reached without endcode*/
+  }
+  *bp += codetree->headbits;
+  for(;;)
+  {
+    if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
+    ct = codetree->tree2d[(treepos << 1) + READBIT(*bp, in)];
+    ++(*bp);
+    if(ct < codetree->numcodes) return ct;
+    treepos = ct - codetree->numcodes;
+    if(treepos >= codetree->numcodes) return (unsigned)(-1); /*error: it appeared outside the codetree*/
+  }
+}
+
 /*
 returns the code, or (unsigned)(-1) if error happened
 inbitlength is the length of the complete buffer, in bits (so its byte length times 8)
@@ -947,21 +1162,27 @@ inbitlength is the length of the complete buffer, in bits (so its byte length ti
 static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
                                     const HuffmanTree* codetree, size_t inbitlength)
 {
-  unsigned treepos = 0, ct;
-  for(;;)
+  /*table lookup instead of walking tree2d one bit at a time, this is the biggest bottleneck while decoding*/
+  unsigned code, l, value, headbits = codetree->headbits;
+  if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
+  code = (unsigned)peekBits(*bp, in, inbitlength >> 3);
+  l = codetree->table_len[code & ((1u << headbits) - 1u)];
+  value = codetree->table_value[code & ((1u << headbits) - 1u)];
+  if(l > headbits)
   {
-    if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
-    /*
-    decode the symbol from the tree. The "readBitFromStream" code is inlined in
-    the expression below because this is the biggest bottleneck while decoding
-    */
-    ct = codetree->tree2d[(treepos << 1) + READBIT(*bp, in)];
-    ++(*bp);
-    if(ct < codetree->numcodes) return ct; /*the symbol is decoded, return it*/
-    else treepos = ct - codetree->numcodes; /*symbol not yet decoded, instead move tree position*/
-
-    if(treepos >= codetree->numcodes) return (unsigned)(-1); /*error: it appeared outside the codetree*/
+    /*long code, second lookup in subtable*/
+    if(l == DEEPCODE) return huffmanDecodeDeep(in, bp, codetree, inbitlength, value);
+    value += (code >> headbits) & ((1u << (l - headbits)) - 1u);
+    l = codetree->table_len[value];
+    value = codetree->table_value[value];
+  }
+  if(*bp + l > inbitlength)
+  {
+    *bp = inbitlength; /*as far as bit by bit decoding gets*/
+    return (unsigned)(-1); /*error: end of input memory reached without endcode*/
   }
+  *bp += l;
+  return value;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -1165,7 +1386,7 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
       /*part 2: get extra bits and add the value of that to length*/
       numextrabits_l = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
       if((*bp + numextrabits_l) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      length += readBitsFromStream(bp, in, numextrabits_l);
+      length += readBitsFast(bp, in, numextrabits_l, inlength);
 
       /*part 3: get distance code*/
       code_d = huffmanDecodeSymbol(in, bp, &tree_d, inbitlength);
@@ -1185,7 +1406,7 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
       /*part 4: get extra bits from distance*/
       numextrabits_d = DISTANCEEXTRA[code_d];
       if((*bp + numextrabits_d) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      distance += readBitsFromStream(bp, in, numextrabits_d);
+      distance += readBitsFast(bp, in, numextrabits_d, inlength);
 
       /*part 5: fill in all the out[n] values based on the length and dist*/
       start = (*pos);
@@ -3968,6 +4189,100 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE2
+/*up to 4 bytes in the low bytes of a register, other bytes 0*/
+static __m128i loadBytesSSE2(const unsigned char* p, size_t num)
+{
+  unsigned value = (unsigned)p[0] | ((unsigned)p[1] << 8u);
+  if(num > 2) value |= (unsigned)p[2] << 16u;
+  if(num > 3) value |= (unsigned)p[3] << 24u;
+  return _mm_cvtsi32_si128((int)value);
+}
+
+static void storeBytesSSE2(unsigned char* p, __m128i bytes, size_t num)
+{
+  unsigned value = (unsigned)_mm_cvtsi128_si32(bytes);
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8u);
+  if(num > 2) p[2] = (unsigned char)(value >> 16u);
+  if(num > 3) p[3] = (unsigned char)(value >> 24u);
+}
+
+/*
+pixel of 3, 4, 6 or 8 bytes in the low bytes of a register, other bytes 0.
+Assembled from integers, going through a buffer in memory stalls the store forwarding.
+*/
+static __m128i loadPixelSSE2(const unsigned char* p, size_t bytewidth)
+{
+  if(bytewidth == 8) return _mm_loadl_epi64((const __m128i*)p);
+  if(bytewidth == 6) return _mm_unpacklo_epi32(loadBytesSSE2(p, 4), loadBytesSSE2(p + 4, 2));
+  return loadBytesSSE2(p, bytewidth);
+}
+
+static void storePixelSSE2(unsigned char* p, __m128i pixel, size_t bytewidth)
+{
+  if(bytewidth == 8) _mm_storel_epi64((__m128i*)p, pixel);
+  else if(bytewidth == 6)
+  {
+    storeBytesSSE2(p, pixel, 4);
+    storeBytesSSE2(p + 4, _mm_srli_si128(pixel, 4), 2);
+  }
+  else storeBytesSSE2(p, pixel, bytewidth);
+}
+
+static __m128i absSSE2(__m128i x)
+{
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+/*Up filter with a previous scanline, 16 bytes per step*/
+static void unfilterUpSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                           size_t length)
+{
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)&scanline[i]),
+                             _mm_loadu_si128((const __m128i*)&precon[i]));
+    _mm_storeu_si128((__m128i*)&recon[i], x);
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+/*
+Paeth filter with a previous scanline for bytewidth 3, 4, 6 or 8, gives exactly the same
+bytes as paethPredictor. Each pixel depends on the one to the left, so all channels of
+one pixel are done per step, in 16-bit lanes.
+*/
+static void unfilterPaethSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                              size_t bytewidth, size_t length)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero;
+  size_t i;
+  for(i = 0; i != length; i += bytewidth)
+  {
+    __m128i b, x, pa, pb, pc, smallest, pick_a, pick_b;
+    b = _mm_unpacklo_epi8(loadPixelSSE2(&precon[i], bytewidth), zero);
+    pa = _mm_sub_epi16(b, c);
+    pb = _mm_sub_epi16(a, c);
+    pc = absSSE2(_mm_add_epi16(pa, pb));
+    pa = absSSE2(pa);
+    pb = absSSE2(pb);
+    smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    /*ties go to a, then b, like paethPredictor*/
+    pick_a = _mm_cmpeq_epi16(smallest, pa);
+    pick_b = _mm_andnot_si128(pick_a, _mm_cmpeq_epi16(smallest, pb));
+    x = _mm_or_si128(_mm_and_si128(pick_a, a), _mm_and_si128(pick_b, b));
+    x = _mm_or_si128(x, _mm_andnot_si128(_mm_or_si128(pick_a, pick_b), c));
+    x = _mm_add_epi8(_mm_packus_epi16(x, x), loadPixelSSE2(&scanline[i], bytewidth));
+    storePixelSSE2(&recon[i], x, bytewidth);
+    a = _mm_unpacklo_epi8(x, zero);
+    c = b;
+  }
+}
+#endif /*LODEPNG_SSE2*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
 {
@@ -3981,6 +4296,23 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SSE2
+  /*
+  Sub and Average are left to the scalar loops, they depend on the pixel to the left
+  as well and the compiler already does the channels of a pixel in parallel there
+  */
+  if(precon && filterType == 2)
+  {
+    unfilterUpSSE2(recon, scanline, precon, length);
+    return 0;
+  }
+  if(precon && filterType == 4 && (bytewidth == 3 || bytewidth == 4 || bytewidth == 6 || bytewidth == 8))
+  {
+    unfilterPaethSSE2(recon, scanline, precon, bytewidth, length);
+    return 0;
+  }
+#endif /*LODEPNG_SSE2*/
+
   switch(filterType)
   {
     case 0:
@@ -4521,9 +4853,10 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+/*target: buffer for the pixels in the PNG's own color mode, or NULL to allocate *out*/
 static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
                           LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+                          const unsigned char* in, size_t insize, unsigned char* target)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
@@ -4711,7 +5044,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   if(!state->error)
   {
     outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
-    *out = (unsigned char*)lodepng_malloc(outsize);
+    *out = target ? target : (unsigned char*)lodepng_malloc(outsize);
     if(!*out) state->error = 83; /*alloc fail*/
   }
   if(!state->error)
@@ -4727,7 +5060,7 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         const unsigned char* in, size_t insize)
 {
   *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
+  decodeGeneric(out, w, h, state, in, insize, 0);
   if(state->error) return state->error;
   if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color))
   {
@@ -4767,6 +5100,37 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
   return state->error;
 }
 
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize)
+{
+  unsigned char* decoded = 0;
+  unsigned convert;
+
+  state->error = lodepng_inspect(w, h, state, in, insize);
+  if(state->error) return state->error;
+  convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+  if(outsize < lodepng_get_raw_size(*w, *h, convert ? &state->info_raw : &state->info_png.color))
+  {
+    return state->error = 95; /*output buffer too small*/
+  }
+  if(convert && !(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+     && !(state->info_raw.bitdepth == 8))
+  {
+    return state->error = 56; /*unsupported color mode conversion*/
+  }
+
+  /*without conversion the pixels go straight into out, else through a temporary buffer like in lodepng_decode*/
+  decodeGeneric(&decoded, w, h, state, in, insize, convert ? 0 : out);
+  if(!state->error)
+  {
+    if(convert) state->error = lodepng_convert(out, decoded, &state->info_raw, &state->info_png.color, *w, *h);
+    else if(!state->decoder.color_convert) state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+  }
+  if(convert) lodepng_free(decoded);
+  return state->error;
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth)
 {
@@ -6000,6 +6364,7 @@ const char* lodepng_error_text(unsigned code)
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
     case 94: return "header chunk must have a size of 13 bytes";
+    case 95: return "output buffer too small for the decoded image";
   }
   return "unknown error code";
 }
@@ -86,6 +86,25 @@ source files with custom allocators.*/
 #include <string>
 #endif /*LODEPNG_COMPILE_CPP*/
 
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*
+Local change: custom memory functions for the calling thread, used by the default
+lodepng_malloc, lodepng_realloc and lodepng_free instead of malloc, realloc and free.
+Memory allocated while an allocator is set must be freed while it is still set, so
+create and clean up the lodepng structs and output buffers used with it in that time.
+*/
+typedef struct LodePNGAllocator
+{
+  void* (*malloc_func)(void* context, size_t size);
+  void* (*realloc_func)(void* context, void* ptr, size_t new_size);
+  void (*free_func)(void* context, void* ptr);
+  void* context; /*passed to the functions as is*/
+} LodePNGAllocator;
+
+/*the allocator is copied; NULL goes back to malloc, realloc and free*/
+void lodepng_set_thread_allocator(const LodePNGAllocator* allocator);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
 #ifdef LODEPNG_COMPILE_PNG
 /*The PNG color types (also used for raw).*/
 typedef enum LodePNGColorType
@@ -659,6 +678,15 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Local change: same as lodepng_decode, but writes the pixels into the caller's buffer of
+outsize bytes instead of allocating one. Use lodepng_inspect and lodepng_get_raw_size with
+state->info_raw first to size it. Gives error 95 if outsize is smaller than the image.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
@@ -0,0 +1,35 @@
+#pragma once
+#include "skyline.hxx"
+#include "texture.hxx"
+#include <memory>
+
+namespace tme {
+
+/// many images in few big gl textures, so batch doesn't break on them
+class atlas_gl_es20 final : public atlas {
+public:
+  atlas_gl_es20(std::uint32_t page_width, std::uint32_t page_height);
+
+  /// copy rgba image into first page with free space, add page if needed
+  /// returned texture is part of page, throw if image is bigger than page
+  texture_gl_es20 *add(const unsigned char *rgba, std::uint32_t w,
+                       std::uint32_t h);
+  atlas_stats get_stats() const final;
+
+private:
+  // empty pixels between images, so neighbours never bleed in filtering
+  static constexpr std::uint32_t padding = 1;
+
+  struct page {
+    page(std::uint32_t w, std::uint32_t h) : tex(w, h), packer(w, h) {}
+    texture_gl_es20 tex;
+    skyline_packer packer;
+  };
+
+  std::uint32_t page_width = 0;
+  std::uint32_t page_height = 0;
+  std::vector<std::unique_ptr<page>> pages;
+  std::uint64_t image_pixels = 0;
+};
+
+} // namespace tme
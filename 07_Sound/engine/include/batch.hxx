@@ -0,0 +1,59 @@
+#pragma once
+#include "raster.hxx"
+#include "shader.hxx"
+#include <vector>
+
+namespace tme {
+
+/// collects textured quads and triangles from many render calls in one
+/// vertex buffer and draws them with one glDrawElements per texture change
+/// batch of quads only draws with one static index buffer; once triangle
+/// is added, indices of whole batch are written and streamed with it
+class sprite_batch {
+public:
+  explicit sprite_batch(shader_gl_es20 *shader);
+  ~sprite_batch();
+
+  /// start new batch, draw what is left of previous one
+  void begin();
+  /// transform triangle on cpu and append it to the batch
+  void submit(const tri2 &t, texture_gl_es20 *tex, const mat3x2 &m);
+  /// transform quad on cpu and append it to the batch
+  void submit(const quad2 &q, texture_gl_es20 *tex, const mat3x2 &m);
+  /// draw all collected triangles, do nothing if batch is empty
+  void flush();
+  /// draw with software rasterizer instead of gl, nullptr - back to gl
+  void set_rasterizer(software_rasterizer *r) { raster = r; }
+
+  /// glDrawElements calls made since last reset_draw_calls
+  std::uint32_t get_draw_calls() const { return draw_calls; }
+  void reset_draw_calls() { draw_calls = 0; }
+
+private:
+  // quads per batch before it is flushed automatically,
+  // limited by 16 bit indices
+  static constexpr std::size_t max_quads = 4096;
+  static constexpr std::size_t max_vertices = 4 * max_quads;
+  // quads take most indices per vertex
+  static constexpr std::size_t max_indices = 6 * max_quads;
+
+  /// flush if texture changes or count more vertices don't fit
+  void prepare(texture_gl_es20 *tex, std::size_t count);
+  void append(const v2 &v, const mat3x2 &m, const std::array<float, 4> &uv);
+
+  shader_gl_es20 *shader = nullptr;
+  uniform_location u_texture;
+  texture_gl_es20 *current_texture = nullptr;
+  std::vector<v2> vertices;
+  // empty while batch has only quads
+  std::vector<std::uint16_t> indices;
+  GLuint vbo = 0;
+  // indices of max_quads quads
+  GLuint ibo = 0;
+  // indices of batches with triangles
+  GLuint stream_ibo = 0;
+  std::uint32_t draw_calls = 0;
+  software_rasterizer *raster = nullptr;
+};
+
+} // namespace tme
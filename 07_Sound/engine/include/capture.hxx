@@ -0,0 +1,70 @@
+#pragma once
+#include "gl_init.hxx"
+#include "thread_pool.hxx"
+#include <array>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tme {
+
+/// saves rendered frames without waiting for gpu
+/// gl frames are read into ring of pixel pack buffers and mapped only
+/// when ring comes back to them, files are encoded on worker thread
+/// path ending with ".y4m" appends frame to raw yuv 4:4:4 video stream,
+/// any other path gets png
+class frame_capture {
+public:
+  /// frame_rate - frames per second written into video headers
+  frame_capture(std::uint32_t width, std::uint32_t height,
+                std::uint32_t frame_rate);
+  /// save frames still in gpu buffers and wait for encoder
+  ~frame_capture();
+  frame_capture(const frame_capture &) = delete;
+  frame_capture &operator=(const frame_capture &) = delete;
+
+  /// save frame finished by next end_frame into path
+  /// second request in one frame replaces path of first
+  void request(std::string_view path);
+  /// start reading bound gl framebuffer if frame was requested, save
+  /// older frames whose reading is done, call before buffers are swapped
+  void end_frame_gl();
+  /// save frame rendered on cpu, pixels are r | g << 8 | b << 16 | a << 24
+  /// with first row at top
+  void end_frame_cpu(const std::vector<std::uint32_t> &pixels);
+
+private:
+  // frames in flight, reading of oldest is surely done when new frame
+  // needs its buffer
+  static constexpr std::size_t ring_size = 3;
+
+  struct slot {
+    GLuint pbo = 0;
+    std::string path;
+    std::uint64_t frame = 0;
+    bool busy = false;
+  };
+
+  void collect(slot &s);
+  void encode(std::string path, std::vector<unsigned char> rgba,
+              bool bottom_up);
+  void write_y4m(const std::string &path,
+                 const std::vector<unsigned char> &rgba, bool bottom_up);
+
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+  std::uint32_t frame_rate = 60;
+  std::uint64_t frame = 0;
+  std::string requested;
+  std::array<slot, ring_size> ring;
+  std::size_t next = 0;
+  // open video streams, used only on encoder thread
+  std::map<std::string, std::unique_ptr<std::ofstream>> streams;
+  // one thread keeps frames of video in order
+  thread_pool encoder{1};
+};
+
+} // namespace tme
@@ -0,0 +1,74 @@
+#pragma once
+#include "gl_debug.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tme {
+
+enum class gl_backend {
+  /// window and opengl context from SDL
+  sdl,
+  /// no window and no gpu, gl calls are only counted
+  null,
+  /// no gpu, triangles are rasterized on cpu threads and shown in
+  /// plain SDL window
+  soft,
+  /// no window, opengl through EGL context renders into offscreen
+  /// framebuffer, works with mesa llvmpipe on servers without display
+  egl
+};
+
+/// how engine::run waits between frames
+enum class frame_pacing {
+  /// swap waits for display refresh, falls back to limit without
+  /// SDL opengl window
+  vsync,
+  /// sleep and spin up to frame_rate frames per second
+  limit,
+  /// no waiting, render as fast as possible
+  uncapped
+};
+
+/// options passed to engine::initialize as "key=value key=value"
+/// pairs are separated by spaces or ';'
+///
+/// gl=sdl|null|soft|egl - rendering backend
+/// threads=N - software rasterizer threads, 0 - one per cpu core
+/// width=N height=N - size of window or offscreen frame in pixels
+/// trace=path - record profiler scopes, save chrome trace on uninitialize
+/// overlay=0|1 - draw frame interval graph
+/// tick=N - engine::run simulation steps per second
+/// pacing=vsync|limit|uncapped - engine::run frame pacing
+/// fps=N - frames per second with pacing=limit, also of captured video
+/// without vsync
+/// load_threads=N - async texture decode threads, 0 - one per cpu core
+/// upload_kb=N - async texture upload budget per frame in KiB
+/// texture_cache=dir - keep decoded png files in dir, off by default
+/// gl_debug=off|callback|strict - gl error checks, see gl_debug_mode
+/// gl_debug_severity=high|medium|low|notification - lowest severity of
+/// debug callback messages
+/// gl_debug_source=all|api|window_system|shader_compiler|third_party|
+/// application|other - producer of debug callback messages
+struct engine_config {
+  gl_backend backend = gl_backend::sdl;
+  std::size_t threads = 0;
+  std::uint32_t width = 640;
+  std::uint32_t height = 480;
+  std::string trace_path;
+  bool overlay = false;
+  std::uint32_t tick_rate = 60;
+  frame_pacing pacing = frame_pacing::vsync;
+  std::uint32_t frame_rate = 60;
+  std::size_t load_threads = 0;
+  std::size_t upload_kb = 8192;
+  std::string texture_cache;
+  gl_debug_mode debug_mode = default_gl_debug_mode;
+  gl_debug_filter debug_filter;
+};
+
+/// throw std::runtime_error on unknown key or bad value
+engine_config parse_config(std::string_view text);
+
+} // namespace tme
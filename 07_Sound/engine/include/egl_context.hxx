@@ -0,0 +1,39 @@
+#pragma once
+#include <SDL2/SDL_egl.h>
+
+namespace tme {
+
+/// desktop opengl context without window or display, current on creating
+/// thread; libEGL is loaded at runtime, so engine still starts on machines
+/// without it
+/// prefers mesa surfaceless platform (llvmpipe works on servers without
+/// gpu), falls back to default display
+class egl_context {
+public:
+  /// throw std::runtime_error if EGL or context is not available
+  /// debug asks for debug context, ignored if EGL can't make one
+  explicit egl_context(bool debug = false);
+  ~egl_context();
+  egl_context(const egl_context &) = delete;
+  egl_context &operator=(const egl_context &) = delete;
+
+  /// loader for gl::init, valid while context exists
+  static void *get_proc_address(const char *name);
+
+private:
+  void create(bool debug);
+  void destroy();
+
+  void *library = nullptr;
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  // only if EGL_KHR_surfaceless_context is missing
+  EGLSurface surface = EGL_NO_SURFACE;
+
+  decltype(&::eglTerminate) eglTerminate = nullptr;
+  decltype(&::eglMakeCurrent) eglMakeCurrent = nullptr;
+  decltype(&::eglDestroyContext) eglDestroyContext = nullptr;
+  decltype(&::eglDestroySurface) eglDestroySurface = nullptr;
+};
+
+} // namespace tme
@@ -1,4 +1,6 @@
 #pragma once
+#include "math.hxx"
+#include <array>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -9,31 +11,6 @@
 
 namespace tme {
 
-struct TME_DECLSPEC vec2 {
-
-  vec2();
-  vec2(float x, float y);
-  float x = 0;
-  float y = 0;
-};
-
-vec2 TME_DECLSPEC operator+(const vec2 &l, const vec2 &r);
-vec2 TME_DECLSPEC operator*(const float &f, const vec2 &v);
-
-struct TME_DECLSPEC mat3x2 {
-  mat3x2();
-  static const mat3x2 identity();
-  static const mat3x2 scale(const float &scale);
-  static const mat3x2 rotation(const float &thetha);
-  static const mat3x2 movement(const vec2 &offset);
-  static const mat3x2 match_640x480();
-  const std::vector<float> get_floats() const;
-  vec2 raw[3];
-};
-
-vec2 TME_DECLSPEC operator*(const vec2 &v, const mat3x2 &m);
-mat3x2 TME_DECLSPEC operator*(const mat3x2 &m1, const mat3x2 &m2);
-
 enum class event {
   left_pressed,
   left_released,
@@ -118,6 +95,22 @@ struct TME_DECLSPEC tri2 {
   v2 v[3];
 };
 
+/// out[i] = in[i] * m, uses widest simd available on current cpu
+/// in and out may point to the same array
+void TME_DECLSPEC transform(const vec2 *in, vec2 *out, std::size_t count,
+                            const mat3x2 &m);
+/// transform vertex positions of count triangles, uv and color are copied
+void TME_DECLSPEC transform(const tri2 *in, tri2 *out, std::size_t count,
+                            const mat3x2 &m);
+
+/// quad with positions color and texture coordinate
+/// corners go around the quad, it is drawn as triangles
+/// (v[0], v[1], v[2]) and (v[0], v[2], v[3]) sharing 2 vertices
+struct TME_DECLSPEC quad2 {
+  quad2();
+  v2 v[4];
+};
+
 std::istream &TME_DECLSPEC operator>>(std::istream &is, mat3x2 &);
 std::istream &TME_DECLSPEC operator>>(std::istream &is, vec2 &);
 std::istream &TME_DECLSPEC operator>>(std::istream &is, color &);
@@ -127,12 +120,75 @@ std::istream &TME_DECLSPEC operator>>(std::istream &is, v2 &);
 std::istream &TME_DECLSPEC operator>>(std::istream &is, tri0 &);
 std::istream &TME_DECLSPEC operator>>(std::istream &is, tri1 &);
 std::istream &TME_DECLSPEC operator>>(std::istream &is, tri2 &);
+std::istream &TME_DECLSPEC operator>>(std::istream &is, quad2 &);
+
+enum class texture_status {
+  /// created by create_texture_async, drawn as transparent placeholder
+  loading,
+  /// image is on gpu
+  ready,
+  /// image could not be decoded, placeholder stays
+  failed
+};
+
+enum class texture_filter { nearest, linear };
+
+/// sampling of texture, fixed at creation
+struct TME_DECLSPEC texture_options {
+  /// filter of texture drawn smaller than its size
+  texture_filter min_filter = texture_filter::nearest;
+  /// filter of texture drawn bigger than its size
+  texture_filter mag_filter = texture_filter::nearest;
+  /// full mip chain made on cpu (and stored in texture_cache), minified
+  /// texture then samples levels closest to its drawn size: min_filter
+  /// nearest - one nearest level, linear - blend of two nearest levels;
+  /// soft renderer always samples level 0
+  bool mipmaps = false;
+};
 
 class TME_DECLSPEC texture {
 public:
   virtual ~texture(){};
+  /// size of placeholder (1x1) until async texture is ready
   virtual std::uint32_t get_width() const = 0;
   virtual std::uint32_t get_height() const = 0;
+  virtual texture_status get_status() const = 0;
+};
+
+/// space usage of atlas, in pixels
+struct TME_DECLSPEC atlas_stats {
+  std::uint32_t pages = 0;
+  std::uint64_t total_pixels = 0;
+  /// taken by images
+  std::uint64_t used_pixels = 0;
+  /// padding and holes between images, never used again
+  std::uint64_t wasted_pixels = 0;
+};
+
+/// pages of big textures with many images packed inside
+/// textures in one page don't break batches
+class TME_DECLSPEC atlas {
+public:
+  virtual ~atlas(){};
+  virtual atlas_stats get_stats() const = 0;
+};
+
+/// one copy of mesh in engine::render_instanced
+struct TME_DECLSPEC instance {
+  mat3x2 m;
+  /// multiplied with texture and vertex color
+  color c;
+  /// part of texture used by copy: uv' = uv_offset + uv * uv_scale
+  vec2 uv_offset;
+  vec2 uv_scale = vec2(1.f, 1.f);
+};
+
+/// triangles with shared vertices stored on gpu side
+class TME_DECLSPEC mesh {
+public:
+  virtual ~mesh(){};
+  virtual std::size_t get_vertex_count() const = 0;
+  virtual std::size_t get_index_count() const = 0;
 };
 
 class TME_DECLSPEC sound {
@@ -150,28 +206,194 @@ private:
   uint32_t buffer_size;
 };
 
+/// counters of one frame, collected between two swap_buffers calls
+struct TME_DECLSPEC render_stats {
+  /// gl state changes sent to driver
+  std::uint32_t gl_calls_issued = 0;
+  /// gl state changes skipped because state was already set
+  std::uint32_t gl_calls_skipped = 0;
+  /// sprites added with engine::enqueue
+  std::uint32_t queued_sprites = 0;
+  /// draw calls made by sprite batch
+  std::uint32_t batches = 0;
+  /// texture switches in sorted frame queue
+  std::uint32_t state_changes = 0;
+  /// time spent on sorting frame queue
+  float sort_ms = 0.f;
+  /// all gl calls, counted only with "gl=null" backend
+  std::uint32_t null_gl_calls = 0;
+};
+
+/// gpu time of one part of frame over last frames, in milliseconds
+struct TME_DECLSPEC gpu_pass_stats {
+  float min_ms = 0.f;
+  float avg_ms = 0.f;
+  /// 99% of frames took not more than this
+  float p99_ms = 0.f;
+};
+
+/// gpu times from ARB_timer_query timestamps, a few frames old
+/// compare frame with cpu frame time to see which side limits frame rate
+struct TME_DECLSPEC gpu_stats {
+  /// false if driver has no timer queries or backend has no gpu,
+  /// all times are zero then
+  bool available = false;
+  /// frames in statistics
+  std::uint32_t frames = 0;
+  /// render calls from previous swap_buffers to this one
+  gpu_pass_stats scene;
+  /// sorted frame queue drawn in swap_buffers
+  gpu_pass_stats queue;
+  /// buffer swap and clear
+  gpu_pass_stats present;
+  /// whole frame, sum of all above
+  gpu_pass_stats frame;
+};
+
+/// distribution of one frame duration, in milliseconds
+struct TME_DECLSPEC timing_percentiles {
+  float p50_ms = 0.f;
+  float p95_ms = 0.f;
+  float p99_ms = 0.f;
+  float max_ms = 0.f;
+};
+
+/// frame times since initialize or reset_frame_timing
+struct TME_DECLSPEC frame_timing {
+  std::uint32_t frames = 0;
+  /// from end of previous swap_buffers to present of this frame
+  timing_percentiles cpu;
+  /// between two presents
+  timing_percentiles interval;
+  /// from first input event of frame to present, only frames with input
+  timing_percentiles input_latency;
+  /// intervals longer than twice the median interval at that moment
+  std::uint32_t hitches = 0;
+};
+
+/// game side of engine::run, all calls come from thread of run
+class TME_DECLSPEC game_loop {
+public:
+  virtual ~game_loop() {}
+  /// input event read since previous frame, keep it for next update
+  /// to stay deterministic
+  virtual void on_event(event e) = 0;
+  /// advance simulation by fixed step dt seconds
+  /// return false to leave engine::run
+  virtual bool update(float dt) = 0;
+  /// draw state between previous and current update, alpha in [0, 1)
+  /// is part of step elapsed since current update; swap_buffers is
+  /// called by engine
+  virtual void render(float alpha) = 0;
+};
+
 class TME_DECLSPEC engine {
 public:
   virtual ~engine() {}
   /// create main window
+  /// config is "key=value" pairs separated by spaces, "" for defaults:
+  ///   gl=sdl|null|soft|egl - opengl in SDL window, or no window and no-op
+  ///                 gl that only counts calls, to measure engine cpu cost,
+  ///                 or multithreaded cpu rasterizer without gpu,
+  ///                 or offscreen opengl through EGL without display
+  ///   threads=N - threads of soft rasterizer, 0 - one per cpu core
+  ///   width=N height=N - frame size, 640x480 by default
+  ///   trace=path - profile engine, chrome trace is saved in uninitialize
+  ///   overlay=0|1 - draw graph of recent frame intervals over frame
+  ///   tick=N - simulation steps per second of run, 60 by default
+  ///   pacing=vsync|limit|uncapped - wait of run between frames
+  ///   fps=N - frame rate of pacing=limit, 60 by default
+  ///   load_threads=N - png decode threads of create_texture_async,
+  ///                 0 - one per cpu core
+  ///   upload_kb=N - async texture bytes uploaded per frame, 8192 by default
+  ///   texture_cache=dir - reuse decoded png files from dir across runs,
+  ///                 they are mapped and uploaded without decoding
+  ///   gl_debug=off|callback|strict - gl error reporting, strict checks
+  ///   every call and is default only in builds without NDEBUG
+  ///   gl_debug_severity=high|medium|low|notification,
+  ///   gl_debug_source=all|api|shader_compiler|... - callback filter
   /// on success return empty string
   virtual std::string initialize(std::string_view config) = 0;
   /// return seconds from initialization
   virtual float get_time_from_init() = 0;
+  /// add interval / 1000 to counter every interval ms until it reaches 1,
+  /// counter changes only inside swap_buffers on calling thread
   virtual bool count_to_1(float *const, const int &) = 0;
+  /// main loop: read input, update game with fixed step, render and
+  /// swap, wait for next frame; return when game.update returns false
+  virtual void run(game_loop &game) = 0;
   /// pool event from input queue
   /// return true if more events in queue
   virtual bool read_input(event &e) = 0;
-  virtual texture *create_texture(std::string_view path) = 0;
+  virtual texture *
+  create_texture(std::string_view path,
+                 const texture_options &options = texture_options()) = 0;
+  /// return placeholder texture at once, png is decoded on loader threads
+  /// and uploaded in swap_buffers within upload_kb budget per frame;
+  /// texture can be drawn and destroyed at any moment
+  virtual texture *
+  create_texture_async(std::string_view path,
+                       const texture_options &options = texture_options()) = 0;
+  /// async textures still loading, loading screen waits for 0
+  virtual std::size_t get_loading_textures() const = 0;
+  /// place image into atlas page instead of separate gl texture
+  virtual texture *create_texture(std::string_view path, atlas *a) = 0;
   virtual void destroy_texture(texture *t) = 0;
+  /// textures are packed into pages of page_width x page_height pixels
+  virtual atlas *create_atlas(std::uint32_t page_width,
+                              std::uint32_t page_height) = 0;
+  /// destroy all textures of atlas before it
+  virtual void destroy_atlas(atlas *a) = 0;
+  /// upload geometry once, every 3 indices make a triangle
+  /// throw on empty or out of range indices
+  virtual mesh *create_mesh(const std::vector<v2> &vertices,
+                            const std::vector<std::uint16_t> &indices) = 0;
+  virtual void destroy_mesh(mesh *m) = 0;
   virtual void render(const tri0 &, const color &) = 0;
   virtual void render(const tri1 &) = 0;
   virtual void render(const tri2 &, texture *) = 0;
   virtual void render(const tri2 &t, texture *tex, const mat3x2 &m) = 0;
   virtual void render(const tri2 &t, texture *tex, const mat3x2 &m_rotate,
                       const mat3x2 &m_move) = 0;
+  virtual void render(mesh *msh, texture *tex, const mat3x2 &m) = 0;
+  /// draw count copies of mesh in one call if ARB_instanced_arrays is
+  /// supported, otherwise copies are transformed on cpu and batched
+  virtual void render_instanced(mesh *msh, texture *tex,
+                                const instance *instances,
+                                std::size_t count) = 0;
+
+  /// start collecting triangles for batched rendering, triangles of
+  /// previous batch not flushed yet are drawn first
+  virtual void begin_batch() = 0;
+  /// add triangle transformed by m to current batch
+  /// batch is drawn when texture changes or on flush_batch
+  virtual void submit(const tri2 &t, texture *tex, const mat3x2 &m) = 0;
+  virtual void submit(const quad2 &q, texture *tex, const mat3x2 &m) = 0;
+  /// draw everything submitted since begin_batch
+  virtual void flush_batch() = 0;
+
+  /// defer quad to end of frame, in swap_buffers all queued quads are sorted
+  /// by layer, texture and depth (smaller first) and drawn with batch
+  virtual void enqueue(const quad2 &q, texture *tex, const mat3x2 &m,
+                       std::uint8_t layer, float depth) = 0;
+
+  /// statistics of last finished frame
+  virtual render_stats get_render_stats() const = 0;
+  /// gpu time statistics of recent frames
+  virtual gpu_stats get_gpu_stats() const = 0;
+  virtual frame_timing get_frame_timing() const = 0;
+  virtual void reset_frame_timing() = 0;
 
   virtual void swap_buffers() = 0;
+  /// copy frame shown by last swap_buffers as rgba rows from top
+  /// return false if backend can't read frames back (gl=sdl, gl=null)
+  virtual bool read_pixels(std::vector<unsigned char> &rgba,
+                           std::uint32_t &width, std::uint32_t &height) = 0;
+  /// save frame finished by next swap_buffers, never waits for gpu:
+  /// file is written a few frames later on worker thread
+  /// path ending with ".y4m" appends frame to raw video stream, other
+  /// paths get png; does nothing with gl=null
+  virtual void capture_frame(std::string_view path) = 0;
   virtual void uninitialize() = 0;
 };
 
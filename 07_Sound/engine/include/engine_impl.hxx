@@ -1,6 +1,19 @@
 #pragma once
+#include "atlas.hxx"
+#include "batch.hxx"
+#include "capture.hxx"
+#include "config.hxx"
+#include "egl_context.hxx"
 #include "engine.hxx"
+#include "frame_stats.hxx"
+#include "framebuffer.hxx"
+#include "gpu_timer.hxx"
+#include "instancing.hxx"
+#include "mesh.hxx"
+#include "raster.hxx"
+#include "render_queue.hxx"
 #include "shader.hxx"
+#include "texture_loader.hxx"
 #include <SDL2/SDL.h>
 
 namespace tme {
@@ -32,13 +45,25 @@ class engine_impl final : public engine {
 public:
   /// create main window
   /// on success return empty string
-  std::string initialize(std::string_view /*config*/) final;
+  std::string initialize(std::string_view config_text) final;
   /// return seconds from initialization
   float get_time_from_init() final;
   bool count_to_1(float *const, const int &) final;
+  void run(game_loop &game) final;
   bool read_input(event &e) final;
-  texture *create_texture(std::string_view path) final;
+  texture *create_texture(std::string_view path,
+                          const texture_options &options) final;
+  texture *create_texture_async(std::string_view path,
+                                const texture_options &options) final;
+  std::size_t get_loading_textures() const final;
+  texture *create_texture(std::string_view path, atlas *a) final;
   void destroy_texture(texture *t) final;
+  atlas *create_atlas(std::uint32_t page_width,
+                      std::uint32_t page_height) final;
+  void destroy_atlas(atlas *a) final;
+  mesh *create_mesh(const std::vector<v2> &vertices,
+                    const std::vector<std::uint16_t> &indices) final;
+  void destroy_mesh(mesh *m) final;
 
   void render(const tri0 &t, const color &c) final;
   void render(const tri1 &t) final;
@@ -46,11 +71,45 @@ public:
   void render(const tri2 &t, texture *tex, const mat3x2 &m) final;
   void render(const tri2 &t, texture *tex, const mat3x2 &m_rotate,
               const mat3x2 &m_move) final;
+  void render(mesh *msh, texture *tex, const mat3x2 &m) final;
+  void render_instanced(mesh *msh, texture *tex, const instance *instances,
+                        std::size_t count) final;
+
+  void begin_batch() final;
+  void submit(const tri2 &t, texture *tex, const mat3x2 &m) final;
+  void submit(const quad2 &q, texture *tex, const mat3x2 &m) final;
+  void flush_batch() final;
+
+  void enqueue(const quad2 &q, texture *tex, const mat3x2 &m,
+               std::uint8_t layer, float depth) final;
+
+  render_stats get_render_stats() const final;
+  gpu_stats get_gpu_stats() const final;
+  frame_timing get_frame_timing() const final;
+  void reset_frame_timing() final;
 
   void swap_buffers() final;
+  bool read_pixels(std::vector<unsigned char> &rgba, std::uint32_t &width,
+                   std::uint32_t &height) final;
+  void capture_frame(std::string_view path) final;
   void uninitialize() final;
 
 private:
+  std::string create_gl_window();
+  std::string create_soft_window();
+  std::string create_egl_context();
+  /// remember time of first input event of frame
+  void note_input(const SDL_Event &e);
+  /// add times of just presented frame to statistics
+  void record_timing(Uint64 cpu_end);
+  /// step counters of count_to_1 that are due
+  void advance_counters(Uint64 now);
+  /// show software framebuffer in window
+  void present_soft();
+  /// transform triangle like shader02 and pass it to software rasterizer
+  void raster_tri2(const tri2 &t, texture_gl_es20 *tex, const mat3x2 &m);
+
+  engine_config config;
   SDL_Window *window = nullptr;
   SDL_GLContext gl_context = nullptr;
 
@@ -58,7 +117,56 @@ private:
   shader_gl_es20 *shader01 = nullptr;
   shader_gl_es20 *shader02 = nullptr;
   shader_gl_es20 *shader_matrix = nullptr;
+  shader_gl_es20 *shader_batch = nullptr;
+
+  uniform_location shader00_color;
+  uniform_location shader02_texture;
+  uniform_location shader02_matrix;
+  uniform_location shader02_uv_rect;
+  uniform_location shader_matrix_texture;
+  uniform_location shader_matrix_uv_rect;
+  uniform_location shader_matrix_rotate;
+  uniform_location shader_matrix_move;
+
+  shader_gl_es20 *shader_instanced = nullptr;
+
+  sprite_batch *batch = nullptr;
+  render_queue *queue = nullptr;
+  // nullptr if ARB_instanced_arrays is not supported
+  instance_renderer *instancing = nullptr;
+  // nullptr unless gl=soft
+  software_rasterizer *raster = nullptr;
+  // gl=egl only, frames[back] is drawn, other one was shown last
+  egl_context *egl = nullptr;
+  framebuffer_gl *frames[2] = {nullptr, nullptr};
+  std::size_t back = 0;
+  // nullptr with gl=null
+  frame_capture *capture = nullptr;
+  // nullptr without ARB_timer_query
+  gpu_timer *timer = nullptr;
+
+  texture_loader *loader = nullptr;
+
+  frame_stats timing;
+  // 1x1 white, only with overlay=1
+  texture_gl_es20 *overlay_texture = nullptr;
+  // SDL_GetPerformanceCounter ticks
+  Uint64 frame_start = 0;
+  Uint64 last_present = 0;
+  // SDL_GetTicks of first input event since last present
+  Uint32 first_input_ms = 0;
+  bool has_input = false;
+
+  render_stats last_frame;
 
-  static uint32_t counter_function(uint32_t interval, void *param);
+  struct step_counter {
+    float *value;
+    // SDL_GetPerformanceCounter ticks
+    Uint64 interval;
+    Uint64 next;
+  };
+  std::vector<step_counter> counters;
+  // SDL_GetPerformanceCounter at initialize
+  Uint64 init_counter = 0;
 };
 } // namespace tme
@@ -0,0 +1,25 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+namespace tme {
+
+/// holds frame rate of engine::run below target without busy waiting:
+/// sleeps most of remaining time, spins only last part because SDL_Delay
+/// may oversleep by scheduler quantum
+class frame_pacer {
+public:
+  /// period in SDL_GetPerformanceCounter ticks, 0 - never wait
+  explicit frame_pacer(Uint64 period);
+
+  /// return when period since previous deadline is over
+  void wait();
+
+private:
+  Uint64 period;
+  Uint64 spin_ticks;
+  Uint64 ms_ticks;
+  // 0 until first wait
+  Uint64 deadline = 0;
+};
+
+} // namespace tme
@@ -0,0 +1,31 @@
+#pragma once
+#include "batch.hxx"
+#include "histogram.hxx"
+
+namespace tme {
+
+/// frame time histograms filled by engine in swap_buffers
+class frame_stats {
+public:
+  /// interval_us == 0 - first frame, latency_us < 0 - no input this frame
+  void record(std::uint64_t cpu_us, std::uint64_t interval_us,
+              std::int64_t latency_us);
+  frame_timing get() const;
+  void reset();
+
+  /// bars of last intervals in bottom left corner, green up to 60 fps
+  /// frame, yellow up to 30 fps, red above; line marks 60 fps
+  void draw_overlay(sprite_batch &batch, texture_gl_es20 *white) const;
+
+private:
+  static constexpr std::size_t recent_size = 128;
+
+  latency_histogram cpu;
+  latency_histogram interval;
+  latency_histogram input_latency;
+  std::uint32_t hitches = 0;
+  std::array<float, recent_size> recent_ms{};
+  std::size_t recent_next = 0;
+};
+
+} // namespace tme
@@ -0,0 +1,32 @@
+#pragma once
+#include "gl_init.hxx"
+#include <vector>
+
+namespace tme {
+
+/// offscreen rgba8 render target made of framebuffer object and
+/// renderbuffer, used instead of window when there is no display
+class framebuffer_gl {
+public:
+  /// throw std::runtime_error if framebuffer is not complete
+  framebuffer_gl(std::uint32_t width, std::uint32_t height);
+  framebuffer_gl(const framebuffer_gl &) = delete;
+  framebuffer_gl &operator=(const framebuffer_gl &) = delete;
+  ~framebuffer_gl();
+
+  /// draw and read from this framebuffer
+  void bind() const;
+  /// copy pixels as rgba rows from top, binds this framebuffer
+  void read_pixels(std::vector<unsigned char> &rgba) const;
+
+  std::uint32_t get_width() const { return width; }
+  std::uint32_t get_height() const { return height; }
+
+private:
+  GLuint fbo = 0;
+  GLuint color = 0;
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+};
+
+} // namespace tme
@@ -0,0 +1,48 @@
+#pragma once
+
+// GL_CHECK() calls glGetError only in builds with TME_GL_CHECKS=1,
+// by default that are builds without NDEBUG, release pays nothing
+#ifndef TME_GL_CHECKS
+#ifdef NDEBUG
+#define TME_GL_CHECKS 0
+#else
+#define TME_GL_CHECKS 1
+#endif
+#endif
+
+namespace tme {
+
+enum class gl_debug_mode {
+  /// no error checks
+  off,
+  /// driver reports errors and warnings through KHR_debug callback,
+  /// gl calls run without extra synchronization
+  callback,
+  /// glGetError after every gl call and synchronous debug callback,
+  /// only for development, works if engine is built with TME_GL_CHECKS
+  strict
+};
+
+constexpr gl_debug_mode default_gl_debug_mode =
+    TME_GL_CHECKS ? gl_debug_mode::strict : gl_debug_mode::off;
+
+/// lowest severity of debug messages passed to callback
+enum class gl_debug_severity { high, medium, low, notification };
+
+/// producer of debug messages passed to callback
+enum class gl_debug_source {
+  all,
+  api,
+  window_system,
+  shader_compiler,
+  third_party,
+  application,
+  other
+};
+
+struct gl_debug_filter {
+  gl_debug_severity severity = gl_debug_severity::medium;
+  gl_debug_source source = gl_debug_source::all;
+};
+
+} // namespace tme
@@ -1,38 +1,48 @@
 #pragma once
+#include "gl_debug.hxx"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 #include <SDL2/SDL_opengl_glext.h>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 
 namespace tme {
 
+#if TME_GL_CHECKS
 #define GL_CHECK()                                                             \
   {                                                                            \
-    const unsigned int err = glGetError();                                     \
-    if (err != GL_NO_ERROR) {                                                  \
-      switch (err) {                                                           \
-      case GL_INVALID_ENUM:                                                    \
-        std::cerr << "GL_INVALID_ENUM" << std::endl;                           \
-        break;                                                                 \
-      case GL_INVALID_VALUE:                                                   \
-        std::cerr << "GL_INVALID_VALUE" << std::endl;                          \
-        break;                                                                 \
-      case GL_INVALID_OPERATION:                                               \
-        std::cerr << "GL_INVALID_OPERATION" << std::endl;                      \
-        break;                                                                 \
-      case GL_INVALID_FRAMEBUFFER_OPERATION:                                   \
-        std::cerr << "GL_INVALID_FRAMEBUFFER_OPERATION" << std::endl;          \
-        break;                                                                 \
-      case GL_OUT_OF_MEMORY:                                                   \
-        std::cerr << "GL_OUT_OF_MEMORY" << std::endl;                          \
-        break;                                                                 \
-      }                                                                        \
-      assert(false);                                                           \
+    if (tme::gl::strict_checks) {                                              \
+      tme::gl::check_error(__FILE__, __LINE__);                                \
     }                                                                          \
   }
+#else
+#define GL_CHECK()                                                             \
+  {}
+#endif
+
 class gl {
 public:
+  // core OpenGL 1.1 functions are linked directly, pointers to them are
+  // kept here only so another backend can replace them
+  static decltype(&::glGetError) glGetError;
+  static decltype(&::glEnable) glEnable;
+  static decltype(&::glDisable) glDisable;
+  static decltype(&::glBlendFunc) glBlendFunc;
+  static decltype(&::glViewport) glViewport;
+  static decltype(&::glClear) glClear;
+  static decltype(&::glClearColor) glClearColor;
+  static decltype(&::glDrawArrays) glDrawArrays;
+  static decltype(&::glDrawElements) glDrawElements;
+  static decltype(&::glGenTextures) glGenTextures;
+  static decltype(&::glDeleteTextures) glDeleteTextures;
+  static decltype(&::glBindTexture) glBindTexture;
+  static decltype(&::glTexImage2D) glTexImage2D;
+  static decltype(&::glTexSubImage2D) glTexSubImage2D;
+  static decltype(&::glTexParameteri) glTexParameteri;
+  static decltype(&::glReadPixels) glReadPixels;
+
   // we have to load all extension GL function pointers
   // dynamically from OpenGL library
   // so first declare function pointers for all we need
@@ -54,11 +64,71 @@ public:
   static PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArray;
   static PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray;
   static PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
+  static PFNGLGETACTIVEUNIFORMPROC glGetActiveUniform;
   static PFNGLUNIFORM1IPROC glUniform1i;
   static PFNGLACTIVETEXTUREPROC glActiveTextureMY;
   static PFNGLUNIFORM4FVPROC glUniform4fv;
   static PFNGLUNIFORMMATRIX3FVPROC glUniformMatrix3fv;
+  static PFNGLGENBUFFERSPROC glGenBuffers;
+  static PFNGLDELETEBUFFERSPROC glDeleteBuffers;
+  static PFNGLBINDBUFFERPROC glBindBuffer;
+  static PFNGLBUFFERDATAPROC glBufferData;
+  static PFNGLBUFFERSUBDATAPROC glBufferSubData;
+
+  // optional, valid only if has_instanced_arrays is true
+  static PFNGLVERTEXATTRIBDIVISORARBPROC glVertexAttribDivisorARB;
+  static PFNGLDRAWELEMENTSINSTANCEDARBPROC glDrawElementsInstancedARB;
+  static bool has_instanced_arrays;
+
+  // optional, valid only if has_framebuffer_objects is true
+  static PFNGLGENFRAMEBUFFERSPROC glGenFramebuffers;
+  static PFNGLDELETEFRAMEBUFFERSPROC glDeleteFramebuffers;
+  static PFNGLBINDFRAMEBUFFERPROC glBindFramebuffer;
+  static PFNGLFRAMEBUFFERRENDERBUFFERPROC glFramebufferRenderbuffer;
+  static PFNGLCHECKFRAMEBUFFERSTATUSPROC glCheckFramebufferStatus;
+  static PFNGLGENRENDERBUFFERSPROC glGenRenderbuffers;
+  static PFNGLDELETERENDERBUFFERSPROC glDeleteRenderbuffers;
+  static PFNGLBINDRENDERBUFFERPROC glBindRenderbuffer;
+  static PFNGLRENDERBUFFERSTORAGEPROC glRenderbufferStorage;
+  static bool has_framebuffer_objects;
+
+  // optional, valid only if has_pixel_buffer_objects is true
+  static PFNGLMAPBUFFERPROC glMapBuffer;
+  static PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+  static bool has_pixel_buffer_objects;
+
+  // optional, valid only if has_timer_query is true
+  static PFNGLGENQUERIESPROC glGenQueries;
+  static PFNGLDELETEQUERIESPROC glDeleteQueries;
+  static PFNGLQUERYCOUNTERPROC glQueryCounter;
+  static PFNGLGETQUERYOBJECTIVPROC glGetQueryObjectiv;
+  static PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v;
+  static bool has_timer_query;
+
+  // optional, valid only if has_debug_output is true
+  static PFNGLDEBUGMESSAGECALLBACKPROC glDebugMessageCallback;
+  static PFNGLDEBUGMESSAGECONTROLPROC glDebugMessageControl;
+  static bool has_debug_output;
+
+  /// read by GL_CHECK(), true only in strict mode
+  static bool strict_checks;
+  /// print every pending glGetError code, assert if there was any
+  static void check_error(const char *file, int line);
+  /// call after init, return false if callback was asked for but
+  /// KHR_debug is missing or strict checks are not compiled in
+  static bool set_debug_mode(gl_debug_mode mode,
+                             const gl_debug_filter &filter);
+  /// debug messages passed filter since set_debug_mode, callback may
+  /// run on driver thread
+  static std::atomic<std::uint32_t> debug_messages;
 
-  static void init();
+  /// returns address of gl function or nullptr
+  using proc_loader = void *(*)(const char *name);
+  /// load functions of current context, from SDL if loader is nullptr
+  static void init(proc_loader loader = nullptr);
+  /// backend without gpu: every function does nothing, only counts calls
+  static void init_null();
+  /// calls made into null backend
+  static std::uint32_t null_calls;
 };
 }
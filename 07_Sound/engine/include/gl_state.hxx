@@ -0,0 +1,51 @@
+#pragma once
+#include <SDL2/SDL_opengl.h>
+#include <array>
+#include <cstdint>
+
+namespace tme {
+
+/// remembers gl state set by engine and skips calls that change nothing
+/// all gl state changes in engine must go through this class, otherwise
+/// cached values become wrong
+class gl_state {
+public:
+  /// forget everything, call after new gl context is created
+  static void reset();
+
+  static void use_program(GLuint program);
+  static void bind_texture(GLuint unit, GLuint texture);
+  static void bind_array_buffer(GLuint buffer);
+  static void bind_element_buffer(GLuint buffer);
+  /// bit i set - vertex attribute i enabled, all others are disabled
+  static void enable_attribs(std::uint32_t mask);
+  static void blend(bool enabled);
+  static void blend_func(GLenum src, GLenum dst);
+  static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+  /// must be called before object is deleted in gl
+  static void forget_texture(GLuint texture);
+  static void forget_buffer(GLuint buffer);
+
+  static std::uint32_t calls_issued;
+  static std::uint32_t calls_skipped;
+
+private:
+  static constexpr std::size_t max_texture_units = 8;
+  static constexpr std::uint32_t max_attribs = 8;
+
+  static void active_texture(GLuint unit);
+
+  static GLuint program;
+  static GLuint active_unit;
+  static std::array<GLuint, max_texture_units> textures;
+  static GLuint array_buffer;
+  static GLuint element_buffer;
+  static std::uint32_t attrib_mask;
+  static bool blend_enabled;
+  static GLenum blend_src;
+  static GLenum blend_dst;
+  static std::array<GLint, 4> viewport_rect;
+};
+
+} // namespace tme
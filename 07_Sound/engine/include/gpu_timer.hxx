@@ -0,0 +1,52 @@
+#pragma once
+#include "engine.hxx"
+#include "gl_init.hxx"
+#include <array>
+
+namespace tme {
+
+/// measures gpu time of frame parts with GL_TIMESTAMP queries
+/// elapsed time queries can't be nested, so frame is cut by timestamps
+/// placed between parts; results are read a few frames later without
+/// waiting, frames whose results are not ready in time are skipped
+/// needs gl::has_timer_query
+class gpu_timer {
+public:
+  enum mark { frame_begin, scene_end, queue_end, frame_end, mark_count };
+
+  gpu_timer();
+  ~gpu_timer();
+  gpu_timer(const gpu_timer &) = delete;
+  gpu_timer &operator=(const gpu_timer &) = delete;
+
+  /// put timestamp into gpu command stream of current frame
+  void set_mark(mark m);
+  /// after frame_end mark: read finished frames and start next frame
+  void end_frame();
+  /// min, avg and p99 over last history_size frames
+  gpu_stats get_stats() const;
+
+private:
+  // frames in flight
+  static constexpr std::size_t latency = 4;
+  static constexpr std::size_t history_size = 128;
+  static constexpr std::size_t pass_count = 4;
+
+  struct frame_queries {
+    std::array<GLuint, mark_count> queries{};
+    bool pending = false;
+  };
+
+  bool read(frame_queries &f);
+  static gpu_pass_stats summarize(const std::array<float, history_size> &ms,
+                                  std::size_t count);
+
+  std::array<frame_queries, latency> ring;
+  std::size_t current = 0;
+  // pass times in ms: scene, queue, present, frame
+  std::array<std::array<float, history_size>, pass_count> history{};
+  std::size_t history_count = 0;
+  std::size_t history_next = 0;
+};
+
+} // namespace tme
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace tme {
+
+/// counts of microsecond durations with ~1.6% relative error at any
+/// magnitude, like HdrHistogram: values below 128 have own bucket, every
+/// next power of two is split into 64 buckets
+/// record and percentile are O(1) and O(buckets), no allocations
+class latency_histogram {
+public:
+  void record(std::uint64_t us);
+  /// smallest recorded bucket value not less than fraction of all values,
+  /// fraction in 0..1, 0 if empty
+  std::uint64_t percentile(double fraction) const;
+  std::uint64_t get_max() const { return max; }
+  std::uint64_t get_count() const { return count; }
+  void reset();
+
+private:
+  static constexpr std::uint32_t sub_bits = 6;
+  static constexpr std::uint32_t sub_count = 1 << sub_bits;
+  // values up to 2^36 us (~19 hours), bigger are counted as largest
+  static constexpr std::uint32_t max_shift = 30;
+  static constexpr std::size_t bucket_count =
+      2 * sub_count + max_shift * sub_count;
+
+  static std::size_t bucket_of(std::uint64_t us);
+  static std::uint64_t value_of(std::size_t bucket);
+
+  std::array<std::uint64_t, bucket_count> buckets{};
+  std::uint64_t count = 0;
+  std::uint64_t max = 0;
+};
+
+} // namespace tme
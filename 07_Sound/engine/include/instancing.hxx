@@ -0,0 +1,27 @@
+#pragma once
+#include "mesh.hxx"
+#include "shader.hxx"
+
+namespace tme {
+
+/// draws many copies of one mesh with one glDrawElementsInstancedARB
+/// per-instance data goes to vertex attributes 3..7 with divisor 1
+/// use only if gl::has_instanced_arrays is true
+class instance_renderer {
+public:
+  explicit instance_renderer(shader_gl_es20 *shader);
+  ~instance_renderer();
+
+  void render(mesh_gl_es20 *msh, texture_gl_es20 *tex,
+              const instance *instances, std::size_t count);
+
+private:
+  shader_gl_es20 *shader = nullptr;
+  uniform_location u_texture;
+  uniform_location u_uv_rect;
+  GLuint vbo = 0;
+  // instances buffer grows only, so steady scenes don't reallocate
+  std::size_t capacity = 0;
+};
+
+} // namespace tme
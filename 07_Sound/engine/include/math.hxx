@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <vector>
+
+#ifndef TME_DECLSPEC
+#define TME_DECLSPEC
+#endif
+
+// functions below are constexpr or inline, so games inline and fold them;
+// matrix.cxx makes libengine keep exported copies of them for binaries
+// built against older libengine, which call them through the library
+
+namespace tme {
+
+struct TME_DECLSPEC vec2 {
+  constexpr vec2();
+  constexpr vec2(float x_, float y_);
+  float x = 0;
+  float y = 0;
+};
+
+constexpr vec2 TME_DECLSPEC operator+(const vec2 &l, const vec2 &r);
+constexpr vec2 TME_DECLSPEC operator*(const float &f, const vec2 &v);
+
+/// 2d affine transform, vectors are rows: v * m
+/// raw[0], raw[1] - linear part, raw[2] - translation
+/// factories return const mat3x2 like exported functions they replace
+struct TME_DECLSPEC mat3x2 {
+  constexpr mat3x2();
+  static constexpr const mat3x2 identity();
+  static constexpr const mat3x2 scale(const float &scale);
+  static inline const mat3x2 rotation(const float &thetha);
+  static constexpr const mat3x2 movement(const vec2 &offset);
+  static constexpr const mat3x2 match_640x480();
+  /// column-major 3x3 matrix ready for glUniformMatrix3fv
+  constexpr std::array<float, 9> get_column_major() const {
+    return {{raw[0].x, raw[1].x, raw[2].x, raw[0].y, raw[1].y, raw[2].y, 0.f,
+             0.f, 1.f}};
+  }
+  /// get_column_major copied to heap, kept for binaries built against
+  /// older libengine; allocates, so render path uses get_column_major
+  const std::vector<float> get_floats() const;
+  vec2 raw[3];
+};
+
+constexpr vec2 TME_DECLSPEC operator*(const vec2 &v, const mat3x2 &m);
+/// result applies m1 first, then m2
+constexpr mat3x2 TME_DECLSPEC operator*(const mat3x2 &m1,
+                                        const mat3x2 &m2);
+
+constexpr vec2::vec2() : x(0.f), y(0.f) {}
+constexpr vec2::vec2(float x_, float y_) : x(x_), y(y_) {}
+
+constexpr vec2 operator+(const vec2 &l, const vec2 &r) {
+  return vec2(l.x + r.x, l.y + r.y);
+}
+
+constexpr vec2 operator*(const float &f, const vec2 &v) {
+  return vec2(f * v.x, f * v.y);
+}
+
+constexpr mat3x2::mat3x2() : raw{vec2(), vec2(), vec2()} {}
+
+constexpr const mat3x2 mat3x2::identity() { return mat3x2::scale(1.f); }
+
+constexpr const mat3x2 mat3x2::scale(const float &scale) {
+  mat3x2 result;
+  result.raw[0].x = scale;
+  result.raw[1].y = scale;
+  return result;
+}
+
+inline const mat3x2 mat3x2::rotation(const float &thetha) {
+  const float c = std::cos(thetha);
+  const float s = std::sin(thetha);
+  mat3x2 result;
+  result.raw[0] = vec2(c, -s);
+  result.raw[1] = vec2(s, c);
+  return result;
+}
+
+constexpr const mat3x2 mat3x2::movement(const vec2 &offset) {
+  mat3x2 result = mat3x2::identity();
+  result.raw[2] = offset;
+  return result;
+}
+
+constexpr const mat3x2 mat3x2::match_640x480() {
+  mat3x2 result;
+  result.raw[0].x = 1;
+  result.raw[1].y = 640.f / 480.f;
+  return result;
+}
+
+constexpr vec2 operator*(const vec2 &v, const mat3x2 &m) {
+  return vec2(v.x * m.raw[0].x + v.y * m.raw[1].x + m.raw[2].x,
+              v.x * m.raw[0].y + v.y * m.raw[1].y + m.raw[2].y);
+}
+
+constexpr mat3x2 operator*(const mat3x2 &m1, const mat3x2 &m2) {
+  mat3x2 r;
+
+  r.raw[0].x = m1.raw[0].x * m2.raw[0].x + m1.raw[0].y * m2.raw[1].x;
+  r.raw[0].y = m1.raw[0].x * m2.raw[0].y + m1.raw[0].y * m2.raw[1].y;
+  r.raw[1].x = m1.raw[1].x * m2.raw[0].x + m1.raw[1].y * m2.raw[1].x;
+  r.raw[1].y = m1.raw[1].x * m2.raw[0].y + m1.raw[1].y * m2.raw[1].y;
+  r.raw[2].x =
+      m1.raw[2].x * m2.raw[0].x + m1.raw[2].y * m2.raw[1].x + m2.raw[2].x;
+  r.raw[2].y =
+      m1.raw[2].x * m2.raw[0].y + m1.raw[2].y * m2.raw[1].y + m2.raw[2].y;
+
+  return r;
+}
+
+} // namespace tme
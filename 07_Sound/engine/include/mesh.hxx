@@ -0,0 +1,35 @@
+#pragma once
+#include "engine.hxx"
+#include <SDL2/SDL_opengl.h>
+
+namespace tme {
+
+/// static geometry uploaded once into gl vertex and index buffers
+class mesh_gl_es20 final : public mesh {
+public:
+  mesh_gl_es20(const std::vector<v2> &vertices,
+               const std::vector<std::uint16_t> &indices);
+  ~mesh_gl_es20() override;
+
+  /// bind buffers and point vertex attributes 0, 1, 2 into them
+  void bind() const;
+  std::size_t get_vertex_count() const final { return vertex_count; }
+  std::size_t get_index_count() const final { return index_count; }
+  /// cpu copy for paths that can't use gpu buffers, empty when driver
+  /// has instanced arrays
+  const std::vector<v2> &get_vertices() const { return vertices; }
+  const std::vector<std::uint16_t> &get_indices() const { return indices; }
+  /// 4 vertices drawn as (0, 1, 2) and (0, 2, 3), same as quad2
+  bool is_quad() const { return quad; }
+
+private:
+  GLuint vbo = 0;
+  GLuint ibo = 0;
+  std::size_t vertex_count = 0;
+  std::size_t index_count = 0;
+  std::vector<v2> vertices;
+  std::vector<std::uint16_t> indices;
+  bool quad = false;
+};
+
+} // namespace tme
@@ -0,0 +1,27 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace tme {
+
+/// levels of full mip chain down to 1x1, 1 for 1x1 image
+std::uint32_t mip_levels(std::uint32_t width, std::uint32_t height);
+
+/// width or height of level, halved per level and at least 1
+inline std::uint32_t mip_size(std::uint32_t size, std::uint32_t level) {
+  return std::max(1u, size >> level);
+}
+
+/// bytes of rgba levels 0 .. levels - 1 stored one after another
+std::size_t mip_chain_size(std::uint32_t width, std::uint32_t height,
+                           std::uint32_t levels);
+
+/// fill levels 1 .. levels - 1 of rgba chain from level 0
+/// every texel is box filtered from 2x2 texels of level above (2x3, 3x2 or
+/// 3x3 at last row and column of odd sizes) in linear light, colors are
+/// weighted by alpha so transparent texels don't darken edges
+void generate_mips(unsigned char *chain, std::uint32_t width,
+                   std::uint32_t height, std::uint32_t levels);
+
+} // namespace tme
@@ -0,0 +1,62 @@
+#pragma once
+#include "engine.hxx"
+#include <atomic>
+#include <cstdint>
+
+namespace tme {
+
+/// cpu time of named scopes on every thread, for finding frame spikes
+/// every thread writes into its own ring buffer without locks, oldest
+/// events are overwritten; recording is off until set_enabled(true)
+/// define TME_NO_PROFILE to compile all scopes out
+class TME_DECLSPEC profiler {
+public:
+  /// records time from construction to destruction, name must be string
+  /// literal or otherwise live until trace is written
+  class scope {
+  public:
+    explicit scope(const char *name_)
+        : name(name_), begin(is_enabled() ? now() : 0) {}
+    ~scope() {
+      if (begin != 0) {
+        record(name, begin, now());
+      }
+    }
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+
+  private:
+    const char *name;
+    std::uint64_t begin;
+  };
+
+  static void set_enabled(bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+  }
+  static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+  /// nanoseconds of steady clock, never 0
+  static std::uint64_t now();
+  static void record(const char *name, std::uint64_t begin_ns,
+                     std::uint64_t end_ns);
+  /// save events kept in all ring buffers as chrome trace_event json,
+  /// open it in chrome://tracing or ui.perfetto.dev; return false if
+  /// file can't be written
+  static bool write_chrome_trace(std::string_view path);
+
+private:
+  static std::atomic<bool> enabled;
+};
+
+} // namespace tme
+
+#define TME_PROFILE_CONCAT_IMPL(a, b) a##b
+#define TME_PROFILE_CONCAT(a, b) TME_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef TME_NO_PROFILE
+#define TME_PROFILE_SCOPE(name)
+#else
+/// measure rest of enclosing block
+#define TME_PROFILE_SCOPE(name)                                                \
+  const ::tme::profiler::scope TME_PROFILE_CONCAT(tme_profile_scope_,          \
+                                                  __LINE__)(name)
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+#include "texture.hxx"
+#include "thread_pool.hxx"
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+
+/// renders triangles on cpu without any gpu
+/// triangles are collected during frame, binned into screen tiles and
+/// tiles are rasterized in parallel on thread pool, so triangles in one
+/// tile are blended in submission order
+/// framebuffer pixels are r | g << 8 | b << 16 | a << 24, first row is top
+class software_rasterizer {
+public:
+  /// 0 threads - one per cpu core
+  software_rasterizer(std::uint32_t width, std::uint32_t height,
+                      std::size_t threads);
+
+  /// triangle with positions in gl clip coordinates and uv in coordinates
+  /// of whole texture page, tex == nullptr - vertex colors only
+  void draw(const v2 &a, const v2 &b, const v2 &c,
+            const texture_gl_es20 *tex);
+  /// rasterize all triangles collected since previous call
+  void finish_frame();
+  void clear(std::uint32_t rgba);
+  /// make finished frame the front one and clear next frame with rgba
+  void swap(std::uint32_t rgba);
+
+  /// frame being drawn
+  const std::vector<std::uint32_t> &get_pixels() const { return pixels; }
+  /// frame finished before last swap
+  const std::vector<std::uint32_t> &get_front() const { return front; }
+  std::uint32_t get_width() const { return width; }
+  std::uint32_t get_height() const { return height; }
+  /// triangles rasterized by last finish_frame, after splitting
+  std::size_t get_last_triangles() const { return last_triangles; }
+
+private:
+  static constexpr std::uint32_t tile_size = 64;
+
+  /// vertex in pixels
+  struct vertex {
+    float x;
+    float y;
+    float u;
+    float v;
+    float rgba[4];
+  };
+
+  /// triangle ready for rasterization
+  /// edge i is a[i] * x + b[i] * y + c[i] in subpixels, it is opposite to
+  /// vertex i and not negative inside triangle
+  struct triangle {
+    std::int32_t a[3];
+    std::int32_t b[3];
+    std::int64_t c[3];
+    float inv_area;
+    // attribute of vertex 0 and its change to vertices 1 and 2
+    float attr0[6];
+    float attr_d1[6];
+    float attr_d2[6];
+    const unsigned char *texels;
+    std::int32_t tex_width;
+    std::int32_t tex_height;
+    // pixel bounding box, inclusive
+    std::int32_t min_x;
+    std::int32_t min_y;
+    std::int32_t max_x;
+    std::int32_t max_y;
+  };
+
+  void add(const vertex &v0, const vertex &v1, const vertex &v2,
+           const texture_gl_es20 *tex, int depth);
+  void setup(const vertex &v0, const vertex &v1, const vertex &v2,
+             const texture_gl_es20 *tex);
+  void draw_tile(std::size_t tile);
+  /// blend textured and colored pixel over dst like
+  /// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+  static void shade(const triangle &t, std::int32_t e1, std::int32_t e2,
+                    std::uint32_t &dst);
+
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+  std::uint32_t tiles_x = 0;
+  std::uint32_t tiles_y = 0;
+  std::vector<std::uint32_t> pixels;
+  std::vector<std::uint32_t> front;
+  std::vector<triangle> triangles;
+  // indexes of triangles touching every tile
+  std::vector<std::vector<std::uint32_t>> bins;
+  std::size_t last_triangles = 0;
+  thread_pool pool;
+};
+
+} // namespace tme
@@ -0,0 +1,48 @@
+#pragma once
+#include "batch.hxx"
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+
+/// collects sprites of whole frame, sorts them by 64 bit key and sends
+/// them to batch in that order, so equal textures stay together; batch
+/// draws with one shader, so shader is not part of key
+///
+/// key bits: 63..56 layer, 55..32 texture id, 31..0 depth
+class render_queue {
+public:
+  void push(const quad2 &q, texture_gl_es20 *tex, const mat3x2 &m,
+            std::uint8_t layer, float depth);
+  /// sort everything pushed and submit it to batch, queue becomes empty
+  void flush(sprite_batch &batch);
+
+  std::uint32_t get_last_submissions() const { return last_submissions; }
+  /// texture changes between neighbours after sorting
+  std::uint32_t get_last_state_changes() const { return last_state_changes; }
+  float get_last_sort_ms() const { return last_sort_ms; }
+
+private:
+  struct entry {
+    quad2 q;
+    mat3x2 m;
+    texture_gl_es20 *tex;
+  };
+  struct item {
+    std::uint64_t key;
+    std::uint32_t entry;
+  };
+
+  void sort();
+
+  std::vector<entry> entries;
+  std::vector<item> items;
+  // second buffer for radix sort passes
+  std::vector<item> sorted;
+
+  std::uint32_t last_submissions = 0;
+  std::uint32_t last_state_changes = 0;
+  float last_sort_ms = 0.f;
+};
+
+} // namespace tme
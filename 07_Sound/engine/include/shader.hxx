@@ -1,11 +1,19 @@
 #pragma once
 #include "texture.hxx"
 #include <SDL2/SDL_opengl.h>
+#include <string>
 #include <string_view>
 #include <tuple>
 #include <vector>
 
 namespace tme {
+
+/// location of uniform variable in linked shader program
+/// get it once with shader_gl_es20::get_uniform and reuse on every draw
+struct uniform_location {
+  GLint value = -1;
+};
+
 class shader_gl_es20 {
 public:
   shader_gl_es20(
@@ -13,10 +21,15 @@ public:
       const std::vector<std::tuple<GLuint, const GLchar *>> &attributes);
 
   void use() const;
+  GLuint get_program_id() const { return program_id; }
 
-  void set_uniform(std::string_view uniform_name, const mat3x2 m) const;
-  void set_uniform(std::string_view uniform_name, texture_gl_es20 *texture);
-  void set_uniform(std::string_view uniform_name, const color &c);
+  /// throw if program has no active uniform with such name
+  uniform_location get_uniform(std::string_view uniform_name) const;
+
+  void set_uniform(uniform_location u, const mat3x2 &m) const;
+  void set_uniform(uniform_location u, texture_gl_es20 *texture) const;
+  void set_uniform(uniform_location u, const color &c) const;
+  void set_uniform(uniform_location u, const std::array<float, 4> &v) const;
 
 private:
   GLuint compile_shader(GLenum shader_type, std::string_view src);
@@ -25,6 +38,10 @@ private:
   GLuint vert_shader = 0;
   GLuint frag_shader = 0;
   GLuint program_id = 0;
+  // filled once after link, few uniforms so linear search is enough
+  std::vector<std::pair<std::string, GLint>> uniforms;
+
+  void read_active_uniforms();
 };
 
 } // namespace tme
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+
+/// packs rectangles into fixed size area with skyline bottom-left rule
+/// skyline is list of segments, each remembers top of already used space
+class skyline_packer {
+public:
+  skyline_packer(std::uint32_t width, std::uint32_t height);
+
+  /// find place for w x h rectangle, return false if there is no space
+  bool insert(std::uint32_t w, std::uint32_t h, std::uint32_t &x,
+              std::uint32_t &y);
+
+  std::uint64_t get_used_area() const { return used_area; }
+  /// area under skyline that can't be used any more
+  std::uint64_t get_wasted_area() const { return wasted_area; }
+
+private:
+  struct segment {
+    std::uint32_t x;
+    std::uint32_t y;
+    std::uint32_t width;
+  };
+
+  /// return top of w wide rectangle placed at segment i, false if won't fit
+  bool fit(std::size_t i, std::uint32_t w, std::uint32_t h,
+           std::uint32_t &y) const;
+  void add_level(std::size_t i, std::uint32_t x, std::uint32_t y,
+                 std::uint32_t w, std::uint32_t h);
+
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+  std::vector<segment> skyline;
+  std::uint64_t used_area = 0;
+  std::uint64_t wasted_area = 0;
+};
+
+} // namespace tme
@@ -1,21 +1,95 @@
 #pragma once
 #include "engine.hxx"
+#include "texture_cache.hxx"
+#include <array>
+#include <vector>
 
 namespace tme {
 
+/// png file mapped into memory, size read from its header
+struct png_file {
+  mapped_file bytes;
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+};
+
+/// map png file and read its size without decoding, throw on error
+png_file open_png(std::string_view path);
+
+/// decode png into caller buffer of 4 * width * height bytes, for example
+/// mapped pixel unpack buffer, throw on error; lodepng scratch memory is
+/// kept per thread and reused, so decoding many files does not allocate
+void decode_png(const png_file &file, unsigned char *rgba);
+
+/// decode png file into rgba pixels, throw on error
+std::vector<unsigned char> load_png(std::string_view path,
+                                    std::uint32_t &width,
+                                    std::uint32_t &height);
+
 class texture_gl_es20 final : public texture {
 public:
-  explicit texture_gl_es20(std::string_view path);
+  explicit texture_gl_es20(std::string_view path,
+                           const texture_options &options = texture_options());
+  /// texture with undefined pixels, fill it with update
+  texture_gl_es20(std::uint32_t width, std::uint32_t height);
+  /// 1x1 transparent placeholder with loading status, for async loading
+  static texture_gl_es20 *create_loading(std::string_view path,
+                                         const texture_options &options);
+  /// part of other texture, shares its gl texture and never deletes it
+  texture_gl_es20(const texture_gl_es20 &page, std::uint32_t x,
+                  std::uint32_t y, std::uint32_t w, std::uint32_t h);
+  texture_gl_es20(const texture_gl_es20 &) = delete;
+  texture_gl_es20 &operator=(const texture_gl_es20 &) = delete;
   ~texture_gl_es20() override;
 
-  void bind() const;
+  void bind(std::uint32_t unit = 0) const;
+  /// copy w x h rgba pixels into texture starting from x, y
+  void update(std::uint32_t x, std::uint32_t y, std::uint32_t w,
+              std::uint32_t h, const unsigned char *rgba);
   std::uint32_t get_width() const final { return width; }
   std::uint32_t get_height() const final { return height; }
+  texture_status get_status() const final { return status; }
+  /// replace size and pixels of loading texture keeping its gl name, so
+  /// already recorded draws stay valid; status becomes ready; rgba is
+  /// offset into pixel unpack buffer if one is bound; levels of mip chain
+  /// follow level 0 in rgba
+  void finish_loading(std::uint32_t w, std::uint32_t h, std::uint32_t levels,
+                      const unsigned char *rgba);
+  /// placeholder stays, status becomes failed
+  void fail_loading() { status = texture_status::failed; }
+  std::uint32_t get_handle() const { return tex_handl; }
+  /// small number unique among live gl textures, ids of deleted ones are
+  /// reused; parts of page share its id like its gl texture
+  std::uint32_t get_id() const { return page->id; }
+  const texture_options &get_options() const { return options; }
+  /// xy - offset, zw - scale to map 0..1 texture coordinates into this part
+  /// of gl texture, {0, 0, 1, 1} for whole texture
+  const std::array<float, 4> &get_uv_rect() const { return uv_rect; }
+  /// texture owning gl texture, this for textures not made from pages
+  const texture_gl_es20 &get_page() const { return *page; }
+  /// rgba copy of whole texture, empty unless keep_pixels was set
+  /// before texture creation
+  const std::vector<unsigned char> &get_pixels() const { return pixels; }
+
+  /// software renderer samples textures on cpu, so keep their pixels
+  static bool keep_pixels;
 
 private:
+  void create(const unsigned char *rgba, std::uint32_t levels);
+  /// texture must be bound to unit 0
+  void upload_levels(const unsigned char *rgba, std::uint32_t levels);
+  void apply_filters() const;
+
   std::string file_path;
   uint32_t tex_handl = 0;
+  std::uint32_t id = 0;
   std::uint32_t width = 0;
   std::uint32_t height = 0;
+  texture_options options;
+  bool owns_handle = true;
+  std::array<float, 4> uv_rect{{0.f, 0.f, 1.f, 1.f}};
+  const texture_gl_es20 *page = this;
+  std::vector<unsigned char> pixels;
+  texture_status status = texture_status::ready;
 };
 } // namespace tme
@@ -0,0 +1,80 @@
+#pragma once
+#include "mipmap.hxx"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tme {
+
+/// read only view of whole file mapped into memory
+class mapped_file {
+public:
+  mapped_file() = default;
+  ~mapped_file();
+  mapped_file(mapped_file &&other) noexcept;
+  mapped_file &operator=(mapped_file &&other) noexcept;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  /// return false if file can't be opened or is empty
+  bool open(const std::string &path);
+  const unsigned char *data() const { return bytes; }
+  std::size_t size() const { return length; }
+
+private:
+  void close();
+
+  const unsigned char *bytes = nullptr;
+  std::size_t length = 0;
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+};
+
+/// rgba pixels, decoded into memory or mapped from cooked cache; levels
+/// of mip chain follow each other, see mipmap.hxx
+struct rgba_image {
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+  std::uint32_t levels = 1;
+  std::vector<unsigned char> decoded;
+  mapped_file cooked;
+  std::size_t cooked_offset = 0;
+
+  const unsigned char *data() const {
+    return decoded.empty() ? cooked.data() + cooked_offset : decoded.data();
+  }
+  /// bytes of all levels
+  std::size_t size() const { return mip_chain_size(width, height, levels); }
+};
+
+/// on-disk cache of decoded png files; entry is keyed by source path and
+/// is valid while source file size and modification time are unchanged
+class texture_cache {
+public:
+  /// empty - no cache; directory is created on first write
+  static void set_directory(std::string_view dir);
+
+  /// pixels of png: mapped from valid cache entry, or decoded into
+  /// storage and written to cache; storage lets caller reuse memory of
+  /// previous image; with mipmaps image has full mip chain, generated
+  /// before writing to cache, so cache hits don't make it again;
+  /// throw std::runtime_error like load_png
+  /// safe to call from several threads
+  static rgba_image load(std::string_view path, bool mipmaps = false,
+                         std::vector<unsigned char> storage = {});
+  static bool is_enabled() { return !directory.empty(); }
+
+  static std::uint32_t get_hits() { return hits; }
+  static std::uint32_t get_misses() { return misses; }
+
+private:
+  static std::string directory;
+  static std::atomic<std::uint32_t> hits;
+  static std::atomic<std::uint32_t> misses;
+};
+
+} // namespace tme
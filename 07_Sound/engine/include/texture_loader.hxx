@@ -0,0 +1,104 @@
+#pragma once
+#include "texture.hxx"
+#include "texture_cache.hxx"
+#include "thread_pool.hxx"
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+namespace tme {
+
+/// pixel unpack buffers reused between texture uploads, gl thread only
+class unpack_buffer_pool {
+public:
+  struct buffer {
+    std::uint32_t name = 0;
+    std::size_t capacity = 0;
+    /// nullptr if map failed
+    unsigned char *mapped = nullptr;
+  };
+
+  unpack_buffer_pool() = default;
+  /// deletes all buffers, also ones not released
+  ~unpack_buffer_pool();
+  unpack_buffer_pool(const unpack_buffer_pool &) = delete;
+  unpack_buffer_pool &operator=(const unpack_buffer_pool &) = delete;
+
+  /// orphan free buffer of at least size bytes, or new one, and map it
+  /// for writing; nothing stays bound
+  buffer acquire(std::size_t size);
+  /// buffer must be unmapped
+  void release(const buffer &b);
+
+private:
+  std::vector<buffer> free_buffers;
+  std::vector<std::uint32_t> names;
+};
+
+/// decodes png files of async textures on worker threads, uploads them on
+/// gl thread a few per frame so big level loads don't stall rendering
+class texture_loader {
+public:
+  /// 0 threads - one per cpu core
+  explicit texture_loader(std::size_t threads);
+  /// waits for running decodes, pending ones are dropped
+  ~texture_loader();
+  texture_loader(const texture_loader &) = delete;
+  texture_loader &operator=(const texture_loader &) = delete;
+
+  /// placeholder texture, owned by caller; mip chain is made by worker
+  texture_gl_es20 *load(std::string_view path,
+                        const texture_options &options);
+  /// call before deleting texture that may still be loading
+  void forget(texture_gl_es20 *t);
+  /// gl thread: upload decoded images in order of decoding until budget
+  /// bytes are used, at least one image per call; map unpack buffers for
+  /// images waiting for one while less than 4 * budget bytes are mapped
+  void upload(std::size_t budget);
+  /// textures with loading status
+  std::size_t get_loading() const { return jobs.size(); }
+  /// jobs queued or running on workers, tests wait for 0 instead of
+  /// sleeping
+  std::size_t get_decoding() const { return decoding; }
+
+private:
+  // with unpack buffers a job passes workers twice: first to read image
+  // size, then, after gl thread mapped buffer of that size, to decode
+  // straight into it; otherwise workers decode into reused storage;
+  // mip chain is made in storage, reading back mapped buffer is slow
+  struct job {
+    std::string path;
+    bool mipmaps = false;
+    // read only on gl thread
+    texture_gl_es20 *target = nullptr;
+    std::atomic<bool> cancelled{false};
+    bool unpack = false;
+    rgba_image image;
+    png_file file;
+    unpack_buffer_pool::buffer buffer;
+    bool failed = false;
+  };
+
+  void decode(const std::shared_ptr<job> &j);
+  void submit(const std::shared_ptr<job> &j);
+  /// unmap and return buffer of job, if any
+  void release_buffer(job &j);
+  /// take storage for decoded pixels from spare
+  std::vector<unsigned char> take_spare();
+
+  bool use_unpack_buffers = false;
+  // only gl thread touches jobs, buffers and mapped_bytes
+  std::unordered_map<texture_gl_es20 *, std::shared_ptr<job>> jobs;
+  unpack_buffer_pool buffers;
+  std::size_t mapped_bytes = 0;
+  std::atomic<std::size_t> decoding{0};
+  std::mutex mutex;
+  // decoded by workers, guarded by mutex
+  std::vector<std::shared_ptr<job>> decoded;
+  // storage of uploaded images for next decodes, guarded by mutex
+  std::vector<std::vector<unsigned char>> spare;
+  // declared last, so workers stop before state they use is destroyed
+  thread_pool pool;
+};
+
+} // namespace tme
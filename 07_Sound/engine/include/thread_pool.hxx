@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tme {
+
+/// fixed set of worker threads taking tasks from one queue
+class thread_pool {
+public:
+  /// 0 threads - use number of cpu cores
+  explicit thread_pool(std::size_t threads);
+  ~thread_pool();
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  /// run task on some worker, return immediately
+  void submit(std::function<void()> task);
+  /// call f(0) ... f(count - 1) on workers and calling thread,
+  /// return when all calls are done
+  void parallel_for(std::size_t count,
+                    const std::function<void(std::size_t)> &f);
+
+  std::size_t get_thread_count() const { return workers.size(); }
+
+private:
+  void work();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stop = false;
+};
+
+} // namespace tme
@@ -0,0 +1,59 @@
+#include "atlas.hxx"
+#include <cassert>
+#include <stdexcept>
+
+namespace tme {
+
+atlas_gl_es20::atlas_gl_es20(std::uint32_t page_width_,
+                             std::uint32_t page_height_)
+    : page_width(page_width_), page_height(page_height_) {
+  if (page_width == 0 || page_height == 0) {
+    throw std::runtime_error("atlas page can't be empty");
+  }
+}
+
+texture_gl_es20 *atlas_gl_es20::add(const unsigned char *rgba,
+                                    std::uint32_t w, std::uint32_t h) {
+  if (w + padding > page_width || h + padding > page_height) {
+    throw std::runtime_error("image is bigger than atlas page");
+  }
+  std::uint32_t x = 0;
+  std::uint32_t y = 0;
+  page *target = nullptr;
+  for (const std::unique_ptr<page> &p : pages) {
+    if (p->packer.insert(w + padding, h + padding, x, y)) {
+      target = p.get();
+      break;
+    }
+  }
+  if (target == nullptr) {
+    pages.push_back(std::make_unique<page>(page_width, page_height));
+    target = pages.back().get();
+    // new pixels are undefined, make them transparent once
+    std::vector<unsigned char> clear(4u * page_width * page_height, 0);
+    target->tex.update(0, 0, page_width, page_height, clear.data());
+    const bool placed = target->packer.insert(w + padding, h + padding, x, y);
+    assert(placed);
+    (void)placed;
+  }
+
+  target->tex.update(x, y, w, h, rgba);
+  image_pixels += static_cast<std::uint64_t>(w) * h;
+  return new texture_gl_es20(target->tex, x, y, w, h);
+}
+
+atlas_stats atlas_gl_es20::get_stats() const {
+  atlas_stats stats;
+  stats.pages = static_cast<std::uint32_t>(pages.size());
+  stats.used_pixels = image_pixels;
+  for (const std::unique_ptr<page> &p : pages) {
+    stats.total_pixels += static_cast<std::uint64_t>(page_width) * page_height;
+    // padding and holes under skyline
+    stats.wasted_pixels += p->packer.get_used_area() +
+                           p->packer.get_wasted_area();
+  }
+  stats.wasted_pixels -= image_pixels;
+  return stats;
+}
+
+} // namespace tme
@@ -0,0 +1,192 @@
+#include "batch.hxx"
+#include "gl_init.hxx"
+#include "gl_state.hxx"
+#include <cstddef>
+
+namespace tme {
+
+/// two triangles of quad starting at vertex first
+static void append_quad_indices(std::vector<std::uint16_t> &indices,
+                                std::size_t first) {
+  for (std::size_t corner : {0, 1, 2, 0, 2, 3}) {
+    indices.push_back(static_cast<std::uint16_t>(first + corner));
+  }
+}
+
+sprite_batch::sprite_batch(shader_gl_es20 *shader_) : shader(shader_) {
+  assert(shader != nullptr);
+  u_texture = shader->get_uniform("s_texture");
+  vertices.reserve(max_vertices);
+  indices.reserve(max_indices);
+
+  gl::glGenBuffers(1, &vbo);
+  GL_CHECK();
+  gl_state::bind_array_buffer(vbo);
+  gl::glBufferData(GL_ARRAY_BUFFER, max_vertices * sizeof(v2), nullptr,
+                   GL_STREAM_DRAW);
+  GL_CHECK();
+
+  std::vector<std::uint16_t> quad_indices;
+  quad_indices.reserve(max_indices);
+  for (std::size_t i = 0; i < max_quads; ++i) {
+    append_quad_indices(quad_indices, 4 * i);
+  }
+  gl::glGenBuffers(1, &ibo);
+  GL_CHECK();
+  gl_state::bind_element_buffer(ibo);
+  gl::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   quad_indices.size() * sizeof(std::uint16_t),
+                   quad_indices.data(), GL_STATIC_DRAW);
+  GL_CHECK();
+
+  gl::glGenBuffers(1, &stream_ibo);
+  GL_CHECK();
+  gl_state::bind_element_buffer(stream_ibo);
+  gl::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   max_indices * sizeof(std::uint16_t), nullptr,
+                   GL_STREAM_DRAW);
+  GL_CHECK();
+}
+
+sprite_batch::~sprite_batch() {
+  gl_state::forget_buffer(vbo);
+  gl_state::forget_buffer(ibo);
+  gl_state::forget_buffer(stream_ibo);
+  GLuint buffers[3] = {vbo, ibo, stream_ibo};
+  gl::glDeleteBuffers(3, buffers);
+  GL_CHECK();
+}
+
+void sprite_batch::begin() {
+  // triangles submitted without flush before new batch are drawn, not lost
+  flush();
+  current_texture = nullptr;
+}
+
+void sprite_batch::prepare(texture_gl_es20 *tex, std::size_t count) {
+  assert(tex != nullptr);
+  // parts of one atlas page share gl texture and go to same draw
+  if (current_texture == nullptr ||
+      tex->get_handle() != current_texture->get_handle() ||
+      vertices.size() + count > max_vertices) {
+    flush();
+    current_texture = tex;
+  }
+}
+
+void sprite_batch::append(const v2 &v, const mat3x2 &m,
+                          const std::array<float, 4> &uv) {
+  v2 out = v;
+  out.pos = v.pos * m;
+  out.uv = vec2(uv[0] + v.uv.x * uv[2], uv[1] + v.uv.y * uv[3]);
+  vertices.push_back(out);
+}
+
+void sprite_batch::submit(const tri2 &t, texture_gl_es20 *tex,
+                          const mat3x2 &m) {
+  prepare(tex, 3);
+  if (indices.empty()) {
+    // quads before first triangle can't use static indices any more
+    for (std::size_t first = 0; first < vertices.size(); first += 4) {
+      append_quad_indices(indices, first);
+    }
+  }
+  const std::size_t first = vertices.size();
+  for (std::size_t i = 0; i < 3; ++i) {
+    indices.push_back(static_cast<std::uint16_t>(first + i));
+  }
+  const std::array<float, 4> &uv = tex->get_uv_rect();
+  append(t.v[0], m, uv);
+  append(t.v[1], m, uv);
+  append(t.v[2], m, uv);
+}
+
+void sprite_batch::submit(const quad2 &q, texture_gl_es20 *tex,
+                          const mat3x2 &m) {
+  prepare(tex, 4);
+  if (!indices.empty()) {
+    append_quad_indices(indices, vertices.size());
+  }
+  const std::array<float, 4> &uv = tex->get_uv_rect();
+  for (const v2 &v : q.v) {
+    append(v, m, uv);
+  }
+}
+
+void sprite_batch::flush() {
+  if (vertices.empty()) {
+    return;
+  }
+
+  if (raster != nullptr) {
+    // uv are already in page coordinates
+    const texture_gl_es20 *page = &current_texture->get_page();
+    if (indices.empty()) {
+      for (std::size_t i = 0; i < vertices.size(); i += 4) {
+        raster->draw(vertices[i], vertices[i + 1], vertices[i + 2], page);
+        raster->draw(vertices[i], vertices[i + 2], vertices[i + 3], page);
+      }
+    } else {
+      for (std::size_t i = 0; i < indices.size(); i += 3) {
+        raster->draw(vertices[indices[i]], vertices[indices[i + 1]],
+                     vertices[indices[i + 2]], page);
+      }
+    }
+    ++draw_calls;
+    vertices.clear();
+    indices.clear();
+    return;
+  }
+
+  shader->use();
+  shader->set_uniform(u_texture, current_texture);
+
+  gl_state::bind_array_buffer(vbo);
+  // orphan previous storage so driver doesn't wait for last draw
+  gl::glBufferData(GL_ARRAY_BUFFER, max_vertices * sizeof(v2), nullptr,
+                   GL_STREAM_DRAW);
+  GL_CHECK();
+  gl::glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(v2),
+                      vertices.data());
+  GL_CHECK();
+
+  // positions
+  gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, pos)));
+  GL_CHECK();
+
+  // colors
+  gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, c)));
+  GL_CHECK();
+
+  // texture coordinates
+  gl::glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, uv)));
+  GL_CHECK();
+  gl_state::enable_attribs(0b111);
+
+  GLsizei index_count = static_cast<GLsizei>(vertices.size() / 4 * 6);
+  if (indices.empty()) {
+    gl_state::bind_element_buffer(ibo);
+  } else {
+    gl_state::bind_element_buffer(stream_ibo);
+    gl::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     max_indices * sizeof(std::uint16_t), nullptr,
+                     GL_STREAM_DRAW);
+    GL_CHECK();
+    gl::glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
+                        indices.size() * sizeof(std::uint16_t),
+                        indices.data());
+    GL_CHECK();
+    index_count = static_cast<GLsizei>(indices.size());
+  }
+  gl::glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, nullptr);
+  GL_CHECK();
+  ++draw_calls;
+
+  vertices.clear();
+  indices.clear();
+}
+
+} // namespace tme
@@ -0,0 +1,198 @@
+#include "capture.hxx"
+#include "lodepng.h"
+#include "profiler.hxx"
+#include <algorithm>
+#include <cstring>
+
+namespace tme {
+
+static bool is_video_path(std::string_view path) {
+  const std::string_view ext = ".y4m";
+  return path.size() >= ext.size() &&
+         path.substr(path.size() - ext.size()) == ext;
+}
+
+frame_capture::frame_capture(std::uint32_t width_, std::uint32_t height_,
+                             std::uint32_t frame_rate_)
+    : width(width_), height(height_), frame_rate(frame_rate_) {
+  if (!gl::has_pixel_buffer_objects) {
+    return;
+  }
+  for (slot &s : ring) {
+    gl::glGenBuffers(1, &s.pbo);
+    GL_CHECK();
+    gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    GL_CHECK();
+    gl::glBufferData(GL_PIXEL_PACK_BUFFER, std::size_t{4} * width * height,
+                     nullptr, GL_STREAM_READ);
+    GL_CHECK();
+  }
+  gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  GL_CHECK();
+}
+
+frame_capture::~frame_capture() {
+  for (std::size_t i = 0; i < ring_size; ++i) {
+    slot &s = ring[(next + i) % ring_size];
+    if (s.busy) {
+      collect(s);
+    }
+    if (s.pbo != 0) {
+      gl::glDeleteBuffers(1, &s.pbo);
+      GL_CHECK();
+    }
+  }
+}
+
+void frame_capture::request(std::string_view path) { requested = path; }
+
+void frame_capture::end_frame_gl() {
+  ++frame;
+  // oldest first, so frames of video stay in order
+  for (std::size_t i = 0; i < ring_size; ++i) {
+    slot &s = ring[(next + i) % ring_size];
+    if (s.busy && frame - s.frame >= ring_size - 1) {
+      collect(s);
+    }
+  }
+  if (requested.empty()) {
+    return;
+  }
+
+  const GLsizei w = static_cast<GLsizei>(width);
+  const GLsizei h = static_cast<GLsizei>(height);
+  if (!gl::has_pixel_buffer_objects) {
+    // no way to read asynchronously, wait for gpu right here
+    std::vector<unsigned char> rgba(std::size_t{4} * width * height);
+    gl::glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    GL_CHECK();
+    encode(std::move(requested), std::move(rgba), true);
+    requested.clear();
+    return;
+  }
+
+  slot &s = ring[next];
+  next = (next + 1) % ring_size;
+  if (s.busy) {
+    collect(s);
+  }
+  s.path = std::move(requested);
+  requested.clear();
+  s.frame = frame;
+  s.busy = true;
+
+  gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+  GL_CHECK();
+  // with pack buffer bound glReadPixels only queues copy on gpu
+  gl::glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  GL_CHECK();
+  gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  GL_CHECK();
+}
+
+void frame_capture::end_frame_cpu(const std::vector<std::uint32_t> &pixels) {
+  ++frame;
+  if (requested.empty()) {
+    return;
+  }
+  std::vector<unsigned char> rgba(4 * pixels.size());
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    for (std::size_t k = 0; k < 4; ++k) {
+      rgba[4 * i + k] = static_cast<unsigned char>(pixels[i] >> (8 * k));
+    }
+  }
+  encode(std::move(requested), std::move(rgba), false);
+  requested.clear();
+}
+
+void frame_capture::collect(slot &s) {
+  const std::size_t size = std::size_t{4} * width * height;
+  std::vector<unsigned char> rgba(size);
+  gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+  GL_CHECK();
+  const void *mapped = gl::glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  GL_CHECK();
+  if (mapped != nullptr) {
+    std::memcpy(rgba.data(), mapped, size);
+    gl::glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    GL_CHECK();
+  }
+  gl::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  GL_CHECK();
+  s.busy = false;
+  if (mapped != nullptr) {
+    encode(std::move(s.path), std::move(rgba), true);
+  }
+  s.path.clear();
+}
+
+void frame_capture::encode(std::string path, std::vector<unsigned char> rgba,
+                           bool bottom_up) {
+  // moved, not copied: frame can be megabytes and this is render thread
+  encoder.submit([this, path = std::move(path), rgba = std::move(rgba),
+                  bottom_up]() mutable {
+    TME_PROFILE_SCOPE("encode frame");
+    if (is_video_path(path)) {
+      write_y4m(path, rgba, bottom_up);
+      return;
+    }
+    if (bottom_up) {
+      const std::size_t row_size = std::size_t{4} * width;
+      for (std::size_t top = 0, bottom = height - 1; top < bottom;
+           ++top, --bottom) {
+        std::swap_ranges(rgba.begin() + row_size * top,
+                         rgba.begin() + row_size * (top + 1),
+                         rgba.begin() + row_size * bottom);
+      }
+    }
+    const unsigned error = lodepng::encode(path, rgba, width, height);
+    if (error != 0) {
+      std::cerr << "error: can't save " << path << ": "
+                << lodepng_error_text(error) << std::endl;
+    }
+  });
+}
+
+void frame_capture::write_y4m(const std::string &path,
+                              const std::vector<unsigned char> &rgba,
+                              bool bottom_up) {
+  std::unique_ptr<std::ofstream> &stream = streams[path];
+  if (stream == nullptr) {
+    stream = std::make_unique<std::ofstream>(path, std::ios::binary);
+    // without XCOLORRANGE players take limited range and show full range
+    // frames with wrong contrast
+    *stream << "YUV4MPEG2 W" << width << " H" << height << " F" << frame_rate
+            << ":1 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+  }
+  if (!*stream) {
+    std::cerr << "error: can't write " << path << std::endl;
+    return;
+  }
+
+  // full range bt.601, every plane goes after previous one
+  const std::size_t pixel_count = std::size_t{width} * height;
+  std::vector<unsigned char> planes(3 * pixel_count);
+  for (std::uint32_t y = 0; y < height; ++y) {
+    const std::uint32_t src_row = bottom_up ? height - 1 - y : y;
+    const unsigned char *src = rgba.data() + std::size_t{4} * width * src_row;
+    unsigned char *dst_y = planes.data() + std::size_t{width} * y;
+    unsigned char *dst_u = dst_y + pixel_count;
+    unsigned char *dst_v = dst_u + pixel_count;
+    for (std::uint32_t x = 0; x < width; ++x, src += 4) {
+      const int r = src[0];
+      const int g = src[1];
+      const int b = src[2];
+      dst_y[x] = static_cast<unsigned char>((77 * r + 150 * g + 29 * b + 128)
+                                            >> 8);
+      dst_u[x] = static_cast<unsigned char>(
+          std::min(255, (-43 * r - 85 * g + 128 * b + 32896) >> 8));
+      dst_v[x] = static_cast<unsigned char>(
+          std::min(255, (128 * r - 107 * g - 21 * b + 32896) >> 8));
+    }
+  }
+  *stream << "FRAME\n";
+  stream->write(reinterpret_cast<const char *>(planes.data()),
+                static_cast<std::streamsize>(planes.size()));
+}
+
+} // namespace tme
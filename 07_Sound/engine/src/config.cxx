@@ -0,0 +1,178 @@
+#include "config.hxx"
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace tme {
+
+static void bad_value(std::string_view key, std::string_view value) {
+  throw std::runtime_error("bad config value: " + std::string(key) + '=' +
+                           std::string(value));
+}
+
+static std::size_t parse_size(std::string_view key, std::string_view value) {
+  std::size_t result = 0;
+  const char *end = value.data() + value.size();
+  const std::from_chars_result parsed =
+      std::from_chars(value.data(), end, result);
+  if (value.empty() || parsed.ec != std::errc() || parsed.ptr != end) {
+    bad_value(key, value);
+  }
+  return result;
+}
+
+static std::uint32_t parse_dimension(std::string_view key,
+                                     std::string_view value) {
+  const std::size_t result = parse_size(key, value);
+  // keeps rows of rgba pixels addressable with 32 bit sizes
+  if (result == 0 || result > 16384) {
+    bad_value(key, value);
+  }
+  return static_cast<std::uint32_t>(result);
+}
+
+static std::uint32_t parse_rate(std::string_view key,
+                                std::string_view value) {
+  const std::size_t result = parse_size(key, value);
+  if (result == 0 || result > 1000) {
+    bad_value(key, value);
+  }
+  return static_cast<std::uint32_t>(result);
+}
+
+static gl_debug_severity parse_severity(std::string_view key,
+                                        std::string_view value) {
+  if (value == "high") {
+    return gl_debug_severity::high;
+  } else if (value == "medium") {
+    return gl_debug_severity::medium;
+  } else if (value == "low") {
+    return gl_debug_severity::low;
+  } else if (value == "notification") {
+    return gl_debug_severity::notification;
+  }
+  bad_value(key, value);
+  return gl_debug_severity::high;
+}
+
+static gl_debug_source parse_source(std::string_view key,
+                                    std::string_view value) {
+  const std::pair<std::string_view, gl_debug_source> names[] = {
+      {"all", gl_debug_source::all},
+      {"api", gl_debug_source::api},
+      {"window_system", gl_debug_source::window_system},
+      {"shader_compiler", gl_debug_source::shader_compiler},
+      {"third_party", gl_debug_source::third_party},
+      {"application", gl_debug_source::application},
+      {"other", gl_debug_source::other}};
+  for (const auto &name : names) {
+    if (name.first == value) {
+      return name.second;
+    }
+  }
+  bad_value(key, value);
+  return gl_debug_source::all;
+}
+
+static void apply(engine_config &config, std::string_view key,
+                  std::string_view value) {
+  if (key == "gl") {
+    if (value == "sdl") {
+      config.backend = gl_backend::sdl;
+    } else if (value == "null") {
+      config.backend = gl_backend::null;
+    } else if (value == "soft") {
+      config.backend = gl_backend::soft;
+    } else if (value == "egl") {
+      config.backend = gl_backend::egl;
+    } else {
+      bad_value(key, value);
+    }
+  } else if (key == "threads") {
+    config.threads = parse_size(key, value);
+  } else if (key == "width") {
+    config.width = parse_dimension(key, value);
+  } else if (key == "height") {
+    config.height = parse_dimension(key, value);
+  } else if (key == "trace") {
+    if (value.empty()) {
+      bad_value(key, value);
+    }
+    config.trace_path = value;
+  } else if (key == "overlay") {
+    if (value != "0" && value != "1") {
+      bad_value(key, value);
+    }
+    config.overlay = value == "1";
+  } else if (key == "tick") {
+    config.tick_rate = parse_rate(key, value);
+  } else if (key == "pacing") {
+    if (value == "vsync") {
+      config.pacing = frame_pacing::vsync;
+    } else if (value == "limit") {
+      config.pacing = frame_pacing::limit;
+    } else if (value == "uncapped") {
+      config.pacing = frame_pacing::uncapped;
+    } else {
+      bad_value(key, value);
+    }
+  } else if (key == "fps") {
+    config.frame_rate = parse_rate(key, value);
+  } else if (key == "load_threads") {
+    config.load_threads = parse_size(key, value);
+  } else if (key == "upload_kb") {
+    config.upload_kb = parse_size(key, value);
+    if (config.upload_kb == 0) {
+      bad_value(key, value);
+    }
+  } else if (key == "texture_cache") {
+    if (value.empty()) {
+      bad_value(key, value);
+    }
+    config.texture_cache = value;
+  } else if (key == "gl_debug") {
+    if (value == "off") {
+      config.debug_mode = gl_debug_mode::off;
+    } else if (value == "callback") {
+      config.debug_mode = gl_debug_mode::callback;
+    } else if (value == "strict") {
+      config.debug_mode = gl_debug_mode::strict;
+    } else {
+      bad_value(key, value);
+    }
+  } else if (key == "gl_debug_severity") {
+    config.debug_filter.severity = parse_severity(key, value);
+  } else if (key == "gl_debug_source") {
+    config.debug_filter.source = parse_source(key, value);
+  } else {
+    throw std::runtime_error("unknown config key: " + std::string(key));
+  }
+}
+
+engine_config parse_config(std::string_view text) {
+  engine_config config;
+  const std::string_view separators = " \t\n;";
+
+  std::size_t pos = 0;
+  while (pos < text.size()) {
+    pos = text.find_first_not_of(separators, pos);
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    std::size_t end = text.find_first_of(separators, pos);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    const std::string_view pair = text.substr(pos, end - pos);
+    const std::size_t eq = pair.find('=');
+    if (eq == std::string_view::npos) {
+      throw std::runtime_error("config pair without '=': " +
+                               std::string(pair));
+    }
+    apply(config, pair.substr(0, eq), pair.substr(eq + 1));
+    pos = end;
+  }
+  return config;
+}
+
+} // namespace tme
@@ -0,0 +1,177 @@
+#include "egl_context.hxx"
+#include <SDL2/SDL.h>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace tme {
+
+#ifdef _WIN32
+static const char *const egl_library_name = "libEGL.dll";
+#else
+static const char *const egl_library_name = "libEGL.so.1";
+#endif
+
+static decltype(&::eglGetProcAddress) egl_get_proc_address = nullptr;
+
+template <typename T>
+static void load_egl_func(void *library, const char *func_name, T &result) {
+  void *pointer = SDL_LoadFunction(library, func_name);
+  if (nullptr == pointer) {
+    throw std::runtime_error(std::string("can't load EGL function ") +
+                             func_name);
+  }
+  result = reinterpret_cast<T>(pointer);
+}
+
+/// whole space separated word, not prefix of longer name
+static bool has_extension(const char *list, const char *name) {
+  if (list == nullptr) {
+    return false;
+  }
+  const std::size_t length = std::strlen(name);
+  for (const char *p = std::strstr(list, name); p != nullptr;
+       p = std::strstr(p + 1, name)) {
+    if ((p == list || p[-1] == ' ') && (p[length] == ' ' || p[length] == 0)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+egl_context::egl_context(bool debug) {
+  library = SDL_LoadObject(egl_library_name);
+  if (library == nullptr) {
+    throw std::runtime_error(std::string("can't load ") + egl_library_name +
+                             ": " + SDL_GetError());
+  }
+
+  try {
+    create(debug);
+  } catch (...) {
+    destroy();
+    throw;
+  }
+}
+
+void egl_context::create(bool debug) {
+  decltype(&::eglQueryString) eglQueryString = nullptr;
+  decltype(&::eglGetDisplay) eglGetDisplay = nullptr;
+  decltype(&::eglInitialize) eglInitialize = nullptr;
+  decltype(&::eglBindAPI) eglBindAPI = nullptr;
+  decltype(&::eglChooseConfig) eglChooseConfig = nullptr;
+  decltype(&::eglCreateContext) eglCreateContext = nullptr;
+  decltype(&::eglCreatePbufferSurface) eglCreatePbufferSurface = nullptr;
+  load_egl_func(library, "eglGetProcAddress", egl_get_proc_address);
+  load_egl_func(library, "eglQueryString", eglQueryString);
+  load_egl_func(library, "eglGetDisplay", eglGetDisplay);
+  load_egl_func(library, "eglInitialize", eglInitialize);
+  load_egl_func(library, "eglTerminate", eglTerminate);
+  load_egl_func(library, "eglBindAPI", eglBindAPI);
+  load_egl_func(library, "eglChooseConfig", eglChooseConfig);
+  load_egl_func(library, "eglCreateContext", eglCreateContext);
+  load_egl_func(library, "eglDestroyContext", eglDestroyContext);
+  load_egl_func(library, "eglCreatePbufferSurface", eglCreatePbufferSurface);
+  load_egl_func(library, "eglDestroySurface", eglDestroySurface);
+  load_egl_func(library, "eglMakeCurrent", eglMakeCurrent);
+
+  const char *client_extensions =
+      eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless") &&
+      has_extension(client_extensions, "EGL_EXT_platform_base")) {
+    auto get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            egl_get_proc_address("eglGetPlatformDisplayEXT"));
+    if (get_platform_display != nullptr) {
+      display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    display = EGL_NO_DISPLAY;
+    throw std::runtime_error("can't initialize EGL display");
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    throw std::runtime_error("EGL can't bind desktop opengl api");
+  }
+
+  const EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+                                   EGL_PBUFFER_BIT,
+                                   EGL_RENDERABLE_TYPE,
+                                   EGL_OPENGL_BIT,
+                                   EGL_RED_SIZE,
+                                   8,
+                                   EGL_GREEN_SIZE,
+                                   8,
+                                   EGL_BLUE_SIZE,
+                                   8,
+                                   EGL_ALPHA_SIZE,
+                                   8,
+                                   EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint config_count = 0;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) ||
+      config_count == 0) {
+    throw std::runtime_error("no EGL config with opengl and pbuffer");
+  }
+
+  const char *display_extensions = eglQueryString(display, EGL_EXTENSIONS);
+  if (debug && has_extension(display_extensions, "EGL_KHR_create_context")) {
+    const EGLint debug_attribs[] = {EGL_CONTEXT_FLAGS_KHR,
+                                    EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR,
+                                    EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, debug_attribs);
+  }
+  if (context == EGL_NO_CONTEXT) {
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+  }
+  if (context == EGL_NO_CONTEXT) {
+    throw std::runtime_error("can't create EGL opengl context");
+  }
+
+  // engine renders into framebuffer objects, surface is only needed by
+  // EGL implementations without surfaceless contexts
+  if (!has_extension(display_extensions, "EGL_KHR_surfaceless_context")) {
+    const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    if (surface == EGL_NO_SURFACE) {
+      throw std::runtime_error("can't create EGL pbuffer surface");
+    }
+  }
+  if (!eglMakeCurrent(display, surface, surface, context)) {
+    throw std::runtime_error("can't make EGL context current");
+  }
+}
+
+egl_context::~egl_context() { destroy(); }
+
+void egl_context::destroy() {
+  if (display != EGL_NO_DISPLAY) {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) {
+      eglDestroySurface(display, surface);
+    }
+    if (context != EGL_NO_CONTEXT) {
+      eglDestroyContext(display, context);
+    }
+    eglTerminate(display);
+  }
+  egl_get_proc_address = nullptr;
+  SDL_UnloadObject(library);
+}
+
+void *egl_context::get_proc_address(const char *name) {
+  assert(egl_get_proc_address != nullptr);
+  return reinterpret_cast<void *>(egl_get_proc_address(name));
+}
+
+} // namespace tme
@@ -1,5 +1,8 @@
 #include "engine_impl.hxx"
 #include "gl_init.hxx"
+#include "frame_pacer.hxx"
+#include "gl_state.hxx"
+#include "profiler.hxx"
 #include <algorithm>
 #include <cassert>
 #include <sstream>
@@ -47,33 +50,15 @@ static bool check_input(const SDL_Event &e, const bind *&result) {
   return false;
 }
 
-std::string engine_impl::initialize(std::string_view) {
+std::string engine_impl::create_gl_window() {
   using namespace std;
 
   stringstream serr;
 
-  SDL_version compiled = {0, 0, 0};
-  SDL_version linked = {0, 0, 0};
-
-  SDL_VERSION(&compiled);
-  SDL_GetVersion(&linked);
-
-  if (SDL_COMPILEDVERSION !=
-      SDL_VERSIONNUM(linked.major, linked.minor, linked.patch)) {
-    serr << "warning: SDL2 compiled and linked version mismatch: " << compiled
-         << " " << linked << endl;
-  }
-
-  const int init_result = SDL_Init(SDL_INIT_EVERYTHING);
-  if (init_result != 0) {
-    const char *err_message = SDL_GetError();
-    serr << "error: failed call SDL_Init: " << err_message << endl;
-    return serr.str();
-  }
-
   window =
       SDL_CreateWindow("title", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                       640, 480, ::SDL_WINDOW_OPENGL);
+                       static_cast<int>(config.width),
+                       static_cast<int>(config.height), ::SDL_WINDOW_OPENGL);
 
   if (window == nullptr) {
     const char *err_message = SDL_GetError();
@@ -82,6 +67,10 @@ std::string engine_impl::initialize(std::string_view) {
     return serr.str();
   }
 
+  // KHR_debug messages are guaranteed only in debug contexts
+  if (config.debug_mode != gl_debug_mode::off) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+  }
   gl_context = SDL_GL_CreateContext(window);
   if (gl_context == nullptr) {
     std::string msg("can't create opengl context: ");
@@ -109,6 +98,124 @@ std::string engine_impl::initialize(std::string_view) {
   } catch (std::exception &ex) {
     return ex.what();
   }
+  // without vsync swap returns at once and engine::run paces frames
+  const int swap_interval = config.pacing == frame_pacing::vsync ? 1 : 0;
+  if (SDL_GL_SetSwapInterval(swap_interval) != 0 &&
+      config.pacing == frame_pacing::vsync) {
+    config.pacing = frame_pacing::limit;
+  }
+  return "";
+}
+
+std::string engine_impl::create_soft_window() {
+  window =
+      SDL_CreateWindow("title", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                       static_cast<int>(config.width),
+                       static_cast<int>(config.height), ::SDL_WINDOW_SHOWN);
+  if (window == nullptr) {
+    std::string msg("error: failed call SDL_CreateWindow: ");
+    msg += SDL_GetError();
+    return msg + '\n';
+  }
+  return "";
+}
+
+std::string engine_impl::create_egl_context() {
+  try {
+    egl = new egl_context(config.debug_mode != gl_debug_mode::off);
+    gl::init(&egl_context::get_proc_address);
+    if (!gl::has_framebuffer_objects) {
+      return "offscreen rendering needs framebuffer objects\n";
+    }
+    frames[0] = new framebuffer_gl(config.width, config.height);
+    frames[1] = new framebuffer_gl(config.width, config.height);
+  } catch (std::exception &ex) {
+    return std::string(ex.what()) + '\n';
+  }
+  back = 0;
+  frames[back]->bind();
+  return "";
+}
+
+std::string engine_impl::initialize(std::string_view config_text) {
+  using namespace std;
+
+  stringstream serr;
+
+  try {
+    config = parse_config(config_text);
+  } catch (std::exception &ex) {
+    return ex.what();
+  }
+  if (!config.trace_path.empty()) {
+    profiler::set_enabled(true);
+  }
+  TME_PROFILE_SCOPE("initialize");
+
+  SDL_version compiled = {0, 0, 0};
+  SDL_version linked = {0, 0, 0};
+
+  SDL_VERSION(&compiled);
+  SDL_GetVersion(&linked);
+
+  if (SDL_COMPILEDVERSION !=
+      SDL_VERSIONNUM(linked.major, linked.minor, linked.patch)) {
+    serr << "warning: SDL2 compiled and linked version mismatch: " << compiled
+         << " " << linked << endl;
+  }
+
+  // null and egl backends run on machines without display and sound
+  const bool headless = config.backend == gl_backend::null ||
+                        config.backend == gl_backend::egl;
+  const Uint32 subsystems =
+      headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING;
+  const int init_result = SDL_Init(subsystems);
+  if (init_result != 0) {
+    const char *err_message = SDL_GetError();
+    serr << "error: failed call SDL_Init: " << err_message << endl;
+    return serr.str();
+  }
+
+  if (config.backend == gl_backend::null) {
+    gl::init_null();
+  } else if (config.backend == gl_backend::soft) {
+    // gl objects are still created by null gl, rasterizer only uses
+    // their cpu copies
+    gl::init_null();
+    texture_gl_es20::keep_pixels = true;
+    const std::string error = create_soft_window();
+    if (!error.empty()) {
+      return serr.str() + error;
+    }
+    raster = new software_rasterizer(config.width, config.height,
+                                     config.threads);
+  } else if (config.backend == gl_backend::egl) {
+    const std::string error = create_egl_context();
+    if (!error.empty()) {
+      return serr.str() + error;
+    }
+  } else {
+    const std::string error = create_gl_window();
+    if (!error.empty()) {
+      return serr.str() + error;
+    }
+  }
+
+  if (!gl::set_debug_mode(config.debug_mode, config.debug_filter) &&
+      config.backend != gl_backend::null &&
+      config.backend != gl_backend::soft) {
+    std::cerr << "warning: gl_debug mode is not available, "
+                 "GL_CHECK() is compiled out or KHR_debug is missing"
+              << std::endl;
+  }
+
+  // only SDL opengl window can wait for display refresh
+  if (config.backend != gl_backend::sdl &&
+      config.pacing == frame_pacing::vsync) {
+    config.pacing = frame_pacing::limit;
+  }
+
+  gl_state::reset();
 
   shader00 = new shader_gl_es20(R"(
                                   attribute vec2 a_position;
@@ -126,8 +233,9 @@ std::string engine_impl::initialize(std::string_view) {
                                   )",
                                 {{0, "a_position"}});
 
+  shader00_color = shader00->get_uniform("u_color");
   shader00->use();
-  shader00->set_uniform("u_color", color(1.f, 0.f, 0.f, 1.f));
+  shader00->set_uniform(shader00_color, color(1.f, 0.f, 0.f, 1.f));
 
   shader01 = new shader_gl_es20(
       R"(
@@ -154,6 +262,7 @@ std::string engine_impl::initialize(std::string_view) {
   shader02 = new shader_gl_es20(
       R"(
                 uniform mat3 u_matrix;
+                uniform vec4 u_uv_rect;
                 attribute vec2 a_position;
                 attribute vec2 a_tex_coord;
                 attribute vec4 a_color;
@@ -165,7 +274,7 @@ std::string engine_impl::initialize(std::string_view) {
                 {
                 vec3 temp = vec3(a_position, 1.0);
 
-                v_tex_coord =  a_tex_coord;
+                v_tex_coord = u_uv_rect.xy + a_tex_coord * u_uv_rect.zw;
                 v_color = a_color;
                 temp = (temp * u_matrix);
                 gl_Position = vec4(temp, 1.0);
@@ -184,6 +293,10 @@ std::string engine_impl::initialize(std::string_view) {
                 )",
       {{0, "a_position"}, {1, "a_color"}, {2, "a_tex_coord"}});
 
+  shader02_texture = shader02->get_uniform("s_texture");
+  shader02_matrix = shader02->get_uniform("u_matrix");
+  shader02_uv_rect = shader02->get_uniform("u_uv_rect");
+
   // turn on rendering with just created shader program
   shader02->use();
 
@@ -191,6 +304,7 @@ std::string engine_impl::initialize(std::string_view) {
       R"(
                 uniform mat3 u_rotate_matrix;
                 uniform mat3 u_move_matrix;
+                uniform vec4 u_uv_rect;
                 attribute vec2 a_position;
                 attribute vec2 a_tex_coord;
                 attribute vec4 a_color;
@@ -202,7 +316,7 @@ std::string engine_impl::initialize(std::string_view) {
                 {
                 vec3 temp = vec3(a_position, 1.0);
 
-                v_tex_coord =  a_tex_coord;
+                v_tex_coord = u_uv_rect.xy + a_tex_coord * u_uv_rect.zw;
                 v_color = a_color;
                 temp = (temp * u_rotate_matrix * u_move_matrix);
                 gl_Position = vec4(temp, 1.0);
@@ -221,45 +335,219 @@ std::string engine_impl::initialize(std::string_view) {
                 )",
       {{0, "a_position"}, {1, "a_color"}, {2, "a_tex_coord"}});
 
+  shader_matrix_texture = shader_matrix->get_uniform("s_texture");
+  shader_matrix_uv_rect = shader_matrix->get_uniform("u_uv_rect");
+  shader_matrix_rotate = shader_matrix->get_uniform("u_rotate_matrix");
+  shader_matrix_move = shader_matrix->get_uniform("u_move_matrix");
+
   // turn on rendering with just created shader program
   shader_matrix->use();
 
-  glEnable(GL_BLEND);
-  GL_CHECK();
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  GL_CHECK();
+  // vertices are already transformed on cpu by sprite_batch
+  shader_batch = new shader_gl_es20(
+      R"(
+                attribute vec2 a_position;
+                attribute vec2 a_tex_coord;
+                attribute vec4 a_color;
 
-  glClearColor(0.f, 0.0, 0.f, 0.0f);
-  GL_CHECK();
+                varying vec4 v_color;
+                varying vec2 v_tex_coord;
+
+                void main()
+                {
+                v_tex_coord =  a_tex_coord;
+                v_color = a_color;
+                gl_Position = vec4(a_position, 0.0, 1.0);
+                }
+                )",
+      R"(
+                varying vec2 v_tex_coord;
+                varying vec4 v_color;
+                uniform sampler2D s_texture;
+
+
+                void main()
+                {
+                gl_FragColor = texture2D(s_texture, v_tex_coord) * v_color;
+                }
+                )",
+      {{0, "a_position"}, {1, "a_color"}, {2, "a_tex_coord"}});
+
+  batch = new sprite_batch(shader_batch);
+  batch->set_rasterizer(raster);
+  queue = new render_queue();
+
+  if (gl::has_instanced_arrays) {
+    shader_instanced = new shader_gl_es20(
+        R"(
+                attribute vec2 a_position;
+                attribute vec2 a_tex_coord;
+                attribute vec4 a_color;
+                // per instance
+                attribute vec2 a_row0;
+                attribute vec2 a_row1;
+                attribute vec2 a_row2;
+                attribute vec4 a_instance_color;
+                attribute vec4 a_uv_rect;
+                // part of atlas page
+                uniform vec4 u_uv_rect;
+
+                varying vec4 v_color;
+                varying vec2 v_tex_coord;
 
-  glViewport(0, 0, 640, 480);
+                void main()
+                {
+                vec2 pos = a_position.x * a_row0 + a_position.y * a_row1
+                           + a_row2;
+                vec2 uv = a_uv_rect.xy + a_tex_coord * a_uv_rect.zw;
+                v_tex_coord = u_uv_rect.xy + uv * u_uv_rect.zw;
+                v_color = a_color * a_instance_color;
+                gl_Position = vec4(pos, 0.0, 1.0);
+                }
+                )",
+        R"(
+                varying vec2 v_tex_coord;
+                varying vec4 v_color;
+                uniform sampler2D s_texture;
+
+
+                void main()
+                {
+                gl_FragColor = texture2D(s_texture, v_tex_coord) * v_color;
+                }
+                )",
+        {{0, "a_position"},
+         {1, "a_color"},
+         {2, "a_tex_coord"},
+         {3, "a_row0"},
+         {4, "a_row1"},
+         {5, "a_row2"},
+         {6, "a_instance_color"},
+         {7, "a_uv_rect"}});
+
+    instancing = new instance_renderer(shader_instanced);
+  }
+
+  gl_state::blend(true);
+  gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  gl::glClearColor(0.f, 0.0, 0.f, 0.0f);
   GL_CHECK();
 
-  return "";
-}
+  gl_state::viewport(0, 0, static_cast<GLsizei>(config.width),
+                     static_cast<GLsizei>(config.height));
+
+  if (config.backend != gl_backend::null) {
+    // video runs at rate frames are shown: display refresh with vsync,
+    // fps of config otherwise
+    std::uint32_t video_rate = config.frame_rate;
+    SDL_DisplayMode mode;
+    if (config.pacing == frame_pacing::vsync &&
+        SDL_GetWindowDisplayMode(window, &mode) == 0 &&
+        mode.refresh_rate > 0) {
+      video_rate = static_cast<std::uint32_t>(mode.refresh_rate);
+    }
+    capture = new frame_capture(config.width, config.height, video_rate);
+  }
+  // null and soft backends have no gpu queries, their gl::has_timer_query
+  // is false
+  if (gl::has_timer_query) {
+    timer = new gpu_timer();
+    timer->set_mark(gpu_timer::frame_begin);
+  }
 
-uint32_t engine_impl::counter_function(uint32_t interval, void *param) {
-  float *f_param = static_cast<float *>(param);
-  if ((*f_param) < 1)
-    (*f_param) += static_cast<float>(interval) / 1000.f;
+  if (config.overlay) {
+    const unsigned char white[4] = {255, 255, 255, 255};
+    overlay_texture = new texture_gl_es20(1, 1);
+    overlay_texture->update(0, 0, 1, 1, white);
+  }
+  texture_cache::set_directory(config.texture_cache);
+  loader = new texture_loader(config.load_threads);
+  frame_start = SDL_GetPerformanceCounter();
+  init_counter = frame_start;
 
-  return interval; // repeat the timer
+  return "";
 }
 
 bool engine_impl::count_to_1(float *const counter, const int &interval) {
-  if (!SDL_AddTimer(interval, counter_function, counter))
+  if (counter == nullptr || interval <= 0) {
     return false;
+  }
+  // stepped on caller thread in swap_buffers, timer thread would race
+  // with game reading counter
+  const Uint64 ticks =
+      SDL_GetPerformanceFrequency() * static_cast<Uint64>(interval) / 1000;
+  counters.push_back(
+      step_counter{counter, ticks, SDL_GetPerformanceCounter() + ticks});
   return true;
 }
 
+void engine_impl::advance_counters(Uint64 now) {
+  for (step_counter &c : counters) {
+    const float step = static_cast<float>(c.interval) /
+                       static_cast<float>(SDL_GetPerformanceFrequency());
+    for (; c.next <= now; c.next += c.interval) {
+      if (*c.value < 1) {
+        *c.value += step;
+      }
+    }
+  }
+}
+
+void engine_impl::run(game_loop &game) {
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  const Uint64 tick = frequency / config.tick_rate;
+  const float dt = 1.f / static_cast<float>(config.tick_rate);
+  // after stall (debugger, window drag) simulation drops time instead of
+  // running hundreds of updates to catch up
+  const Uint64 max_elapsed = frequency / 4;
+  frame_pacer pacer(config.pacing == frame_pacing::limit
+                        ? frequency / config.frame_rate
+                        : 0);
+
+  Uint64 previous = SDL_GetPerformanceCounter();
+  Uint64 accumulator = 0;
+  for (;;) {
+    event e;
+    while (read_input(e)) {
+      game.on_event(e);
+    }
+
+    const Uint64 now = SDL_GetPerformanceCounter();
+    accumulator += std::min(now - previous, max_elapsed);
+    previous = now;
+    for (; accumulator >= tick; accumulator -= tick) {
+      TME_PROFILE_SCOPE("update");
+      if (!game.update(dt)) {
+        return;
+      }
+    }
+
+    {
+      TME_PROFILE_SCOPE("game render");
+      game.render(static_cast<float>(accumulator) / static_cast<float>(tick));
+    }
+    swap_buffers();
+    pacer.wait();
+  }
+}
+
 float engine_impl::get_time_from_init() {
-  std::uint32_t ms_from_library_initialization = SDL_GetTicks();
-  float seconds = ms_from_library_initialization * 0.001f;
-  return seconds;
+  const Uint64 ticks = SDL_GetPerformanceCounter() - init_counter;
+  return static_cast<float>(static_cast<double>(ticks) /
+                            SDL_GetPerformanceFrequency());
 }
+void engine_impl::note_input(const SDL_Event &e) {
+  if (!has_input) {
+    first_input_ms = e.common.timestamp;
+    has_input = true;
+  }
+}
+
 /// pool event from input queue
 /// return true if more events in queue
 bool engine_impl::read_input(event &e) {
+  TME_PROFILE_SCOPE("read_input");
   using namespace std;
   // collect all events from SDL
   SDL_Event sdl_event;
@@ -270,11 +558,13 @@ bool engine_impl::read_input(event &e) {
       e = event::turn_off;
       return true;
     } else if (sdl_event.type == SDL_KEYDOWN) {
+      note_input(sdl_event);
       if (check_input(sdl_event, binding)) {
         e = binding->event_pressed;
         return true;
       }
     } else if (sdl_event.type == SDL_KEYUP) {
+      note_input(sdl_event);
       if (check_input(sdl_event, binding)) {
         e = binding->event_released;
         return true;
@@ -284,20 +574,60 @@ bool engine_impl::read_input(event &e) {
   return false;
 }
 
-texture *engine_impl::create_texture(std::string_view path) {
-  return new texture_gl_es20(path);
+texture *engine_impl::create_texture(std::string_view path,
+                                     const texture_options &options) {
+  return new texture_gl_es20(path, options);
+}
+texture *engine_impl::create_texture(std::string_view path, atlas *a) {
+  const rgba_image image = texture_cache::load(path);
+  return static_cast<atlas_gl_es20 *>(a)->add(image.data(), image.width,
+                                              image.height);
+}
+texture *engine_impl::create_texture_async(std::string_view path,
+                                           const texture_options &options) {
+  return loader->load(path, options);
+}
+std::size_t engine_impl::get_loading_textures() const {
+  return loader->get_loading();
+}
+void engine_impl::destroy_texture(texture *t) {
+  loader->forget(static_cast<texture_gl_es20 *>(t));
+  delete t;
 }
-void engine_impl::destroy_texture(texture *t) { delete t; }
+
+atlas *engine_impl::create_atlas(std::uint32_t page_width,
+                                 std::uint32_t page_height) {
+  return new atlas_gl_es20(page_width, page_height);
+}
+void engine_impl::destroy_atlas(atlas *a) { delete a; }
+
+mesh *engine_impl::create_mesh(const std::vector<v2> &vertices,
+                               const std::vector<std::uint16_t> &indices) {
+  return new mesh_gl_es20(vertices, indices);
+}
+void engine_impl::destroy_mesh(mesh *m) { delete m; }
 
 void engine_impl::render(const tri0 &t, const color &c) {
+  TME_PROFILE_SCOPE("render tri0");
+  // keep draw order with already submitted triangles
+  batch->flush();
+  if (raster != nullptr) {
+    v2 v[3];
+    for (std::size_t i = 0; i < 3; ++i) {
+      v[i].pos = t.v[i].pos;
+      v[i].c = c;
+    }
+    raster->draw(v[0], v[1], v[2], nullptr);
+    return;
+  }
   shader00->use();
-  shader00->set_uniform("u_color", c);
+  shader00->set_uniform(shader00_color, c);
+  gl_state::bind_array_buffer(0);
   // vertex coordinates
   gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(v0),
                             &t.v[0].pos.x);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(0);
-  GL_CHECK();
+  gl_state::enable_attribs(0b001);
 
   // texture coordinates
   // glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(v0),
@@ -306,151 +636,406 @@ void engine_impl::render(const tri0 &t, const color &c) {
   // glEnableVertexAttribArray(1);
   // GL_CHECK();
 
-  glDrawArrays(GL_TRIANGLES, 0, 3);
+  gl::glDrawArrays(GL_TRIANGLES, 0, 3);
   GL_CHECK();
 }
 void engine_impl::render(const tri1 &t) {
+  TME_PROFILE_SCOPE("render tri1");
+  batch->flush();
+  if (raster != nullptr) {
+    v2 v[3];
+    for (std::size_t i = 0; i < 3; ++i) {
+      v[i].pos = t.v[i].pos;
+      v[i].c = t.v[i].c;
+    }
+    raster->draw(v[0], v[1], v[2], nullptr);
+    return;
+  }
   shader01->use();
+  gl_state::bind_array_buffer(0);
   // positions
   gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
                             &t.v[0].pos);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(0);
-  GL_CHECK();
   // colors
   gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(t.v[0]),
                             &t.v[0].c);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(1);
-  GL_CHECK();
-
-  glDrawArrays(GL_TRIANGLES, 0, 3);
-  GL_CHECK();
+  gl_state::enable_attribs(0b011);
 
-  gl::glDisableVertexAttribArray(1);
+  gl::glDrawArrays(GL_TRIANGLES, 0, 3);
   GL_CHECK();
 }
-void engine_impl::render(const tri2 &t, texture *tex) {
-  shader02->use();
-  texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
-  texture->bind();
-  shader02->set_uniform("s_texture", texture);
+
+static void set_tri2_attributes(const tri2 &t) {
+  gl_state::bind_array_buffer(0);
   // positions
   gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
                             &t.v[0].pos);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(0);
-  GL_CHECK();
 
   // colors
   gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(t.v[0]),
                             &t.v[0].c);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(1);
-  GL_CHECK();
 
   // texture coordinates
   gl::glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
                             &t.v[0].uv);
   GL_CHECK();
-  gl::glEnableVertexAttribArray(2);
-  GL_CHECK();
+  gl_state::enable_attribs(0b111);
+}
 
-  glDrawArrays(GL_TRIANGLES, 0, 3);
-  GL_CHECK();
+void engine_impl::raster_tri2(const tri2 &t, texture_gl_es20 *tex,
+                              const mat3x2 &m) {
+  const std::array<float, 4> &uv = tex->get_uv_rect();
+  v2 v[3];
+  for (std::size_t i = 0; i < 3; ++i) {
+    v[i] = t.v[i];
+    v[i].pos = t.v[i].pos * m;
+    v[i].uv = vec2(uv[0] + t.v[i].uv.x * uv[2], uv[1] + t.v[i].uv.y * uv[3]);
+  }
+  raster->draw(v[0], v[1], v[2], &tex->get_page());
+}
 
-  gl::glDisableVertexAttribArray(1);
-  GL_CHECK();
-  gl::glDisableVertexAttribArray(2);
+void engine_impl::render(const tri2 &t, texture *tex) {
+  TME_PROFILE_SCOPE("render tri2");
+  batch->flush();
+  texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
+  if (raster != nullptr) {
+    raster_tri2(t, texture, mat3x2::identity());
+    return;
+  }
+  shader02->use();
+  shader02->set_uniform(shader02_texture, texture);
+  shader02->set_uniform(shader02_uv_rect, texture->get_uv_rect());
+  set_tri2_attributes(t);
+
+  gl::glDrawArrays(GL_TRIANGLES, 0, 3);
   GL_CHECK();
 }
 void engine_impl::render(const tri2 &t, texture *tex, const mat3x2 &m) {
-  shader02->use();
+  TME_PROFILE_SCOPE("render tri2 matrix");
+  batch->flush();
   texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
-  texture->bind();
-  shader02->set_uniform("s_texture", texture);
+  if (raster != nullptr) {
+    raster_tri2(t, texture, m);
+    return;
+  }
+  shader02->use();
+  shader02->set_uniform(shader02_texture, texture);
+  shader02->set_uniform(shader02_uv_rect, texture->get_uv_rect());
 
-  shader02->set_uniform("u_matrix", m);
+  shader02->set_uniform(shader02_matrix, m);
+  set_tri2_attributes(t);
 
-  // positions
-  gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
-                            &t.v[0].pos);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(0);
+  gl::glDrawArrays(GL_TRIANGLES, 0, 3);
   GL_CHECK();
+}
 
-  // colors
-  gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(t.v[0]),
-                            &t.v[0].c);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(1);
-  GL_CHECK();
+void engine_impl::render(const tri2 &t, texture *tex, const mat3x2 &m_rotate,
+                         const mat3x2 &m_move) {
+  TME_PROFILE_SCOPE("render tri2 rotate move");
+  batch->flush();
+  texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
+  if (raster != nullptr) {
+    raster_tri2(t, texture, m_rotate * m_move);
+    return;
+  }
+  shader_matrix->use();
+  shader_matrix->set_uniform(shader_matrix_texture, texture);
+  shader_matrix->set_uniform(shader_matrix_uv_rect, texture->get_uv_rect());
 
-  // texture coordinates
-  gl::glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
-                            &t.v[0].uv);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(2);
-  GL_CHECK();
+  shader_matrix->set_uniform(shader_matrix_rotate, m_rotate);
+  shader_matrix->set_uniform(shader_matrix_move, m_move);
+  set_tri2_attributes(t);
 
-  glDrawArrays(GL_TRIANGLES, 0, 3);
+  gl::glDrawArrays(GL_TRIANGLES, 0, 3);
   GL_CHECK();
+}
 
-  gl::glDisableVertexAttribArray(1);
-  GL_CHECK();
-  gl::glDisableVertexAttribArray(2);
+void engine_impl::render(mesh *msh, texture *tex, const mat3x2 &m) {
+  TME_PROFILE_SCOPE("render mesh");
+  batch->flush();
+  texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
+  mesh_gl_es20 *gl_mesh = static_cast<mesh_gl_es20 *>(msh);
+  if (raster != nullptr) {
+    const std::vector<v2> &vertices = gl_mesh->get_vertices();
+    const std::vector<std::uint16_t> &indices = gl_mesh->get_indices();
+    for (std::size_t k = 0; k + 2 < indices.size(); k += 3) {
+      tri2 t;
+      t.v[0] = vertices[indices[k + 0]];
+      t.v[1] = vertices[indices[k + 1]];
+      t.v[2] = vertices[indices[k + 2]];
+      raster_tri2(t, texture, m);
+    }
+    return;
+  }
+  shader02->use();
+  shader02->set_uniform(shader02_texture, texture);
+  shader02->set_uniform(shader02_uv_rect, texture->get_uv_rect());
+  shader02->set_uniform(shader02_matrix, m);
+
+  gl_mesh->bind();
+
+  const GLsizei index_count = static_cast<GLsizei>(gl_mesh->get_index_count());
+  gl::glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, nullptr);
   GL_CHECK();
 }
 
-void engine_impl::render(const tri2 &t, texture *tex, const mat3x2 &m_rotate,
-                         const mat3x2 &m_move) {
-  shader_matrix->use();
+static color modulate(const color &l, const color &r) {
+  return color(l.get_r() * r.get_r(), l.get_g() * r.get_g(),
+               l.get_b() * r.get_b(), l.get_a() * r.get_a());
+}
+
+static v2 instance_vertex(const v2 &v, const instance &inst) {
+  v2 result = v;
+  result.uv = vec2(inst.uv_offset.x + v.uv.x * inst.uv_scale.x,
+                   inst.uv_offset.y + v.uv.y * inst.uv_scale.y);
+  result.c = modulate(v.c, inst.c);
+  return result;
+}
+
+void engine_impl::render_instanced(mesh *msh, texture *tex,
+                                   const instance *instances,
+                                   std::size_t count) {
+  TME_PROFILE_SCOPE("render_instanced");
+  batch->flush();
+  mesh_gl_es20 *gl_mesh = static_cast<mesh_gl_es20 *>(msh);
   texture_gl_es20 *texture = static_cast<texture_gl_es20 *>(tex);
-  texture->bind();
-  shader_matrix->set_uniform("s_texture", texture);
+  if (instancing != nullptr) {
+    instancing->render(gl_mesh, texture, instances, count);
+    return;
+  }
 
-  shader_matrix->set_uniform("u_rotate_matrix", m_rotate);
-  shader_matrix->set_uniform("u_move_matrix", m_move);
+  // no instancing in driver, transform copies on cpu and batch them
+  const std::vector<v2> &vertices = gl_mesh->get_vertices();
+  const std::vector<std::uint16_t> &indices = gl_mesh->get_indices();
+  for (std::size_t i = 0; i < count; ++i) {
+    const instance &inst = instances[i];
+    if (gl_mesh->is_quad()) {
+      quad2 q;
+      for (std::size_t k = 0; k < 4; ++k) {
+        q.v[k] = instance_vertex(vertices[k], inst);
+      }
+      batch->submit(q, texture, inst.m);
+      continue;
+    }
+    for (std::size_t k = 0; k < indices.size(); k += 3) {
+      tri2 t;
+      t.v[0] = instance_vertex(vertices[indices[k + 0]], inst);
+      t.v[1] = instance_vertex(vertices[indices[k + 1]], inst);
+      t.v[2] = instance_vertex(vertices[indices[k + 2]], inst);
+      batch->submit(t, texture, inst.m);
+    }
+  }
+}
 
-  // positions
-  gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
-                            &t.v[0].pos);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(0);
-  GL_CHECK();
+void engine_impl::begin_batch() { batch->begin(); }
 
-  // colors
-  gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(t.v[0]),
-                            &t.v[0].c);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(1);
-  GL_CHECK();
+void engine_impl::submit(const tri2 &t, texture *tex, const mat3x2 &m) {
+  batch->submit(t, static_cast<texture_gl_es20 *>(tex), m);
+}
 
-  // texture coordinates
-  gl::glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(t.v[0]),
-                            &t.v[0].uv);
-  GL_CHECK();
-  gl::glEnableVertexAttribArray(2);
-  GL_CHECK();
+void engine_impl::submit(const quad2 &q, texture *tex, const mat3x2 &m) {
+  batch->submit(q, static_cast<texture_gl_es20 *>(tex), m);
+}
 
-  glDrawArrays(GL_TRIANGLES, 0, 3);
-  GL_CHECK();
+void engine_impl::flush_batch() {
+  TME_PROFILE_SCOPE("flush_batch");
+  batch->flush();
+}
 
-  gl::glDisableVertexAttribArray(1);
-  GL_CHECK();
-  gl::glDisableVertexAttribArray(2);
-  GL_CHECK();
+void engine_impl::enqueue(const quad2 &q, texture *tex, const mat3x2 &m,
+                          std::uint8_t layer, float depth) {
+  queue->push(q, static_cast<texture_gl_es20 *>(tex), m, layer, depth);
 }
 
+render_stats engine_impl::get_render_stats() const { return last_frame; }
+
 void engine_impl::swap_buffers() {
-  SDL_GL_SwapWindow(window);
+  TME_PROFILE_SCOPE("swap_buffers");
+  // queued sprites are drawn over everything rendered directly
+  batch->flush();
+  if (timer != nullptr) {
+    timer->set_mark(gpu_timer::scene_end);
+  }
+  queue->flush(*batch);
+  if (overlay_texture != nullptr) {
+    timing.draw_overlay(*batch, overlay_texture);
+  }
+  batch->flush();
+  if (timer != nullptr) {
+    timer->set_mark(gpu_timer::queue_end);
+  }
+  const Uint64 cpu_end = SDL_GetPerformanceCounter();
+  if (raster != nullptr) {
+    raster->finish_frame();
+    capture->end_frame_cpu(raster->get_pixels());
+    raster->swap(0);
+    present_soft();
+  } else if (egl != nullptr) {
+    capture->end_frame_gl();
+    // shown frame stays untouched for read_pixels until next swap
+    back = 1 - back;
+    frames[back]->bind();
+  } else if (window != nullptr) {
+    capture->end_frame_gl();
+    SDL_GL_SwapWindow(window);
+  }
+
+  record_timing(cpu_end);
 
-  glClear(GL_COLOR_BUFFER_BIT);
+  last_frame.queued_sprites = queue->get_last_submissions();
+  last_frame.state_changes = queue->get_last_state_changes();
+  last_frame.sort_ms = queue->get_last_sort_ms();
+  last_frame.batches = batch->get_draw_calls();
+  batch->reset_draw_calls();
+
+  last_frame.gl_calls_issued = gl_state::calls_issued;
+  last_frame.gl_calls_skipped = gl_state::calls_skipped;
+  gl_state::calls_issued = 0;
+  gl_state::calls_skipped = 0;
+  last_frame.null_gl_calls = gl::null_calls;
+  gl::null_calls = 0;
+
+  gl::glClear(GL_COLOR_BUFFER_BIT);
   GL_CHECK();
+
+  if (timer != nullptr) {
+    timer->set_mark(gpu_timer::frame_end);
+    timer->end_frame();
+    timer->set_mark(gpu_timer::frame_begin);
+  }
+  frame_start = SDL_GetPerformanceCounter();
+  advance_counters(frame_start);
+  // counted in cpu time of next frame, that is where it stalls
+  loader->upload(config.upload_kb * 1024);
 }
+
+void engine_impl::record_timing(Uint64 cpu_end) {
+  const Uint64 presented = SDL_GetPerformanceCounter();
+  const double us_per_tick = 1e6 / SDL_GetPerformanceFrequency();
+  const auto cpu_us =
+      static_cast<std::uint64_t>((cpu_end - frame_start) * us_per_tick);
+  // 0 means first frame for frame_stats, so real intervals are at least 1
+  std::uint64_t interval_us = 0;
+  if (last_present != 0) {
+    const double us = (presented - last_present) * us_per_tick;
+    interval_us = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(us));
+  }
+  // event timestamps have only millisecond precision
+  const std::int64_t latency_us =
+      has_input ? (static_cast<std::int64_t>(SDL_GetTicks()) -
+                   static_cast<std::int64_t>(first_input_ms)) *
+                      1000
+                : -1;
+  timing.record(cpu_us, interval_us, latency_us);
+  last_present = presented;
+  has_input = false;
+}
+
+frame_timing engine_impl::get_frame_timing() const { return timing.get(); }
+
+void engine_impl::reset_frame_timing() { timing.reset(); }
+
+gpu_stats engine_impl::get_gpu_stats() const {
+  return timer != nullptr ? timer->get_stats() : gpu_stats();
+}
+
+void engine_impl::present_soft() {
+  const std::vector<std::uint32_t> &pixels = raster->get_front();
+  const int w = static_cast<int>(raster->get_width());
+  const int h = static_cast<int>(raster->get_height());
+  // surface only reads pixels, it is a blit source
+  SDL_Surface *frame = SDL_CreateRGBSurfaceFrom(
+      const_cast<std::uint32_t *>(pixels.data()), w, h, 32, 4 * w,
+      0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
+  if (frame == nullptr) {
+    return;
+  }
+  SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+  SDL_Surface *screen = SDL_GetWindowSurface(window);
+  if (screen != nullptr) {
+    SDL_BlitSurface(frame, nullptr, screen, nullptr);
+    SDL_UpdateWindowSurface(window);
+  }
+  SDL_FreeSurface(frame);
+}
+
+bool engine_impl::read_pixels(std::vector<unsigned char> &rgba,
+                              std::uint32_t &width, std::uint32_t &height) {
+  if (raster != nullptr) {
+    const std::vector<std::uint32_t> &pixels = raster->get_front();
+    rgba.resize(4 * pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      for (std::size_t k = 0; k < 4; ++k) {
+        rgba[4 * i + k] = static_cast<unsigned char>(pixels[i] >> (8 * k));
+      }
+    }
+    width = raster->get_width();
+    height = raster->get_height();
+    return true;
+  }
+  if (egl != nullptr) {
+    const framebuffer_gl *front = frames[1 - back];
+    front->read_pixels(rgba);
+    frames[back]->bind();
+    width = front->get_width();
+    height = front->get_height();
+    return true;
+  }
+  return false;
+}
+
+void engine_impl::capture_frame(std::string_view path) {
+  if (capture != nullptr) {
+    capture->request(path);
+  }
+}
+
 void engine_impl::uninitialize() {
-  SDL_GL_DeleteContext(gl_context);
-  SDL_DestroyWindow(window);
+  // decoding threads must stop before SDL_Quit
+  delete loader;
+  loader = nullptr;
+  // pending frames are read from gpu, needs live context
+  delete capture;
+  capture = nullptr;
+  delete timer;
+  timer = nullptr;
+  delete overlay_texture;
+  overlay_texture = nullptr;
+  delete queue;
+  queue = nullptr;
+  delete instancing;
+  instancing = nullptr;
+  delete shader_instanced;
+  shader_instanced = nullptr;
+  delete batch;
+  batch = nullptr;
+  delete shader_batch;
+  shader_batch = nullptr;
+  delete raster;
+  raster = nullptr;
+  texture_gl_es20::keep_pixels = false;
+  for (framebuffer_gl *&frame : frames) {
+    delete frame;
+    frame = nullptr;
+  }
+  delete egl;
+  egl = nullptr;
+  if (gl_context != nullptr) {
+    SDL_GL_DeleteContext(gl_context);
+  }
+  if (window != nullptr) {
+    SDL_DestroyWindow(window);
+  }
+  // after capture, so its encoder thread has finished
+  if (!config.trace_path.empty() &&
+      !profiler::write_chrome_trace(config.trace_path)) {
+    std::cerr << "error: can't write trace " << config.trace_path
+              << std::endl;
+  }
   SDL_Quit();
 }
 } // namespace tme
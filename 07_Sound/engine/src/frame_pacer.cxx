@@ -0,0 +1,35 @@
+#include "frame_pacer.hxx"
+#include "profiler.hxx"
+#include <algorithm>
+
+namespace tme {
+
+frame_pacer::frame_pacer(Uint64 period_)
+    : period(period_), spin_ticks(SDL_GetPerformanceFrequency() / 500),
+      ms_ticks(std::max<Uint64>(1, SDL_GetPerformanceFrequency() / 1000)) {}
+
+void frame_pacer::wait() {
+  if (period == 0) {
+    return;
+  }
+  TME_PROFILE_SCOPE("frame_pacer wait");
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (deadline == 0) {
+    deadline = now;
+  }
+  deadline += period;
+  if (now >= deadline) {
+    // frame was late, start new schedule instead of rushing next frames
+    deadline = now;
+    return;
+  }
+  // sleep until 2 ms before deadline, then spin
+  if (deadline - now > spin_ticks) {
+    SDL_Delay(static_cast<Uint32>((deadline - now - spin_ticks) / ms_ticks));
+  }
+  do {
+    now = SDL_GetPerformanceCounter();
+  } while (now < deadline);
+}
+
+} // namespace tme
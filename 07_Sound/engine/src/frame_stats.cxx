@@ -0,0 +1,93 @@
+#include "frame_stats.hxx"
+#include <algorithm>
+
+namespace tme {
+
+static timing_percentiles percentiles(const latency_histogram &h) {
+  timing_percentiles result;
+  result.p50_ms = h.percentile(0.50) * 0.001f;
+  result.p95_ms = h.percentile(0.95) * 0.001f;
+  result.p99_ms = h.percentile(0.99) * 0.001f;
+  result.max_ms = h.get_max() * 0.001f;
+  return result;
+}
+
+void frame_stats::record(std::uint64_t cpu_us, std::uint64_t interval_us,
+                         std::int64_t latency_us) {
+  cpu.record(cpu_us);
+  if (latency_us >= 0) {
+    input_latency.record(static_cast<std::uint64_t>(latency_us));
+  }
+  if (interval_us == 0) {
+    return;
+  }
+  // median needs some frames before it means anything
+  if (interval.get_count() >= 16 &&
+      interval_us > 2 * interval.percentile(0.5)) {
+    ++hitches;
+  }
+  interval.record(interval_us);
+  recent_ms[recent_next] = interval_us * 0.001f;
+  recent_next = (recent_next + 1) % recent_size;
+}
+
+frame_timing frame_stats::get() const {
+  frame_timing result;
+  result.frames = static_cast<std::uint32_t>(cpu.get_count());
+  result.cpu = percentiles(cpu);
+  result.interval = percentiles(interval);
+  result.input_latency = percentiles(input_latency);
+  result.hitches = hitches;
+  return result;
+}
+
+void frame_stats::reset() {
+  cpu.reset();
+  interval.reset();
+  input_latency.reset();
+  hitches = 0;
+  recent_ms.fill(0.f);
+  recent_next = 0;
+}
+
+static void submit_rect(sprite_batch &batch, texture_gl_es20 *white,
+                        float x0, float y0, float x1, float y1,
+                        const color &c) {
+  quad2 q;
+  const vec2 corners[4] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  for (std::size_t i = 0; i < 4; ++i) {
+    q.v[i].pos = corners[i];
+    q.v[i].uv = vec2(0.f, 0.f);
+    q.v[i].c = c;
+  }
+  batch.submit(q, white, mat3x2::identity());
+}
+
+void frame_stats::draw_overlay(sprite_batch &batch,
+                               texture_gl_es20 *white) const {
+  // graph takes quarter of screen width, 50 ms is full height
+  const float left = -0.98f;
+  const float bottom = -0.98f;
+  const float bar_width = 0.5f / recent_size;
+  const float height_per_ms = 0.4f / 50.f;
+
+  submit_rect(batch, white, left, bottom, left + 0.5f, bottom + 0.4f,
+              color(0.f, 0.f, 0.f, 0.5f));
+  for (std::size_t i = 0; i < recent_size; ++i) {
+    const float ms = recent_ms[(recent_next + i) % recent_size];
+    if (ms <= 0.f) {
+      continue;
+    }
+    const color c = ms <= 16.7f   ? color(0.f, 1.f, 0.f, 0.8f)
+                    : ms <= 33.4f ? color(1.f, 1.f, 0.f, 0.8f)
+                                  : color(1.f, 0.f, 0.f, 0.8f);
+    const float x = left + i * bar_width;
+    const float top = bottom + std::min(ms, 50.f) * height_per_ms;
+    submit_rect(batch, white, x, bottom, x + bar_width, top, c);
+  }
+  const float line = bottom + 16.7f * height_per_ms;
+  submit_rect(batch, white, left, line, left + 0.5f, line + 0.004f,
+              color(1.f, 1.f, 1.f, 0.8f));
+}
+
+} // namespace tme
@@ -0,0 +1,65 @@
+#include "framebuffer.hxx"
+#include <algorithm>
+
+namespace tme {
+
+framebuffer_gl::framebuffer_gl(std::uint32_t width_, std::uint32_t height_)
+    : width(width_), height(height_) {
+  assert(gl::has_framebuffer_objects);
+  gl::glGenRenderbuffers(1, &color);
+  GL_CHECK();
+  gl::glBindRenderbuffer(GL_RENDERBUFFER, color);
+  GL_CHECK();
+  gl::glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8,
+                            static_cast<GLsizei>(width),
+                            static_cast<GLsizei>(height));
+  GL_CHECK();
+
+  gl::glGenFramebuffers(1, &fbo);
+  GL_CHECK();
+  bind();
+  gl::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                GL_RENDERBUFFER, color);
+  GL_CHECK();
+
+  const GLenum status = gl::glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  GL_CHECK();
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    gl::glDeleteFramebuffers(1, &fbo);
+    gl::glDeleteRenderbuffers(1, &color);
+    throw std::runtime_error("offscreen framebuffer is not complete: " +
+                             std::to_string(status));
+  }
+}
+
+framebuffer_gl::~framebuffer_gl() {
+  gl::glDeleteFramebuffers(1, &fbo);
+  GL_CHECK();
+  gl::glDeleteRenderbuffers(1, &color);
+  GL_CHECK();
+}
+
+void framebuffer_gl::bind() const {
+  gl::glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  GL_CHECK();
+}
+
+void framebuffer_gl::read_pixels(std::vector<unsigned char> &rgba) const {
+  bind();
+  const std::size_t row_size = std::size_t{4} * width;
+  rgba.resize(row_size * height);
+  gl::glReadPixels(0, 0, static_cast<GLsizei>(width),
+                   static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE,
+                   rgba.data());
+  GL_CHECK();
+
+  // gl rows go from bottom
+  for (std::size_t top = 0, bottom = height - 1; top < bottom;
+       ++top, --bottom) {
+    std::swap_ranges(rgba.begin() + row_size * top,
+                     rgba.begin() + row_size * (top + 1),
+                     rgba.begin() + row_size * bottom);
+  }
+}
+
+} // namespace tme
@@ -1,16 +1,77 @@
 #include "gl_init.hxx"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace tme {
 
+// nullptr - take functions from SDL gl context
+static gl::proc_loader gl_loader = nullptr;
+
+static void *get_gl_proc(const char *func_name) {
+  return gl_loader != nullptr ? gl_loader(func_name)
+                              : SDL_GL_GetProcAddress(func_name);
+}
+
+static bool extension_supported(const char *name) {
+  if (gl_loader == nullptr) {
+    return SDL_GL_ExtensionSupported(name);
+  }
+  const char *all =
+      reinterpret_cast<const char *>(::glGetString(GL_EXTENSIONS));
+  if (all == nullptr) {
+    return false;
+  }
+  // whole space separated word, not prefix of longer name
+  const std::string_view list(all);
+  const std::string_view ext(name);
+  for (std::size_t pos = list.find(ext); pos != std::string_view::npos;
+       pos = list.find(ext, pos + 1)) {
+    const std::size_t end = pos + ext.size();
+    if ((pos == 0 || list[pos - 1] == ' ') &&
+        (end == list.size() || list[end] == ' ')) {
+      return true;
+    }
+  }
+  return false;
+}
+
 template <typename T>
 static void load_gl_func(const char *func_name, T &result) {
-  void *gl_pointer = SDL_GL_GetProcAddress(func_name);
+  void *gl_pointer = get_gl_proc(func_name);
   if (nullptr == gl_pointer) {
     throw std::runtime_error(std::string("can't load GL function") + func_name);
   }
   result = reinterpret_cast<T>(gl_pointer);
 }
 
+/// for functions from optional extensions, return false if not found
+template <typename T>
+static bool try_load_gl_func(const char *func_name, T &result) {
+  void *gl_pointer = get_gl_proc(func_name);
+  result = reinterpret_cast<T>(gl_pointer);
+  return nullptr != gl_pointer;
+}
+
+decltype(&::glGetError) gl::glGetError = nullptr;
+decltype(&::glEnable) gl::glEnable = nullptr;
+decltype(&::glDisable) gl::glDisable = nullptr;
+decltype(&::glBlendFunc) gl::glBlendFunc = nullptr;
+decltype(&::glViewport) gl::glViewport = nullptr;
+decltype(&::glClear) gl::glClear = nullptr;
+decltype(&::glClearColor) gl::glClearColor = nullptr;
+decltype(&::glDrawArrays) gl::glDrawArrays = nullptr;
+decltype(&::glDrawElements) gl::glDrawElements = nullptr;
+decltype(&::glGenTextures) gl::glGenTextures = nullptr;
+decltype(&::glDeleteTextures) gl::glDeleteTextures = nullptr;
+decltype(&::glBindTexture) gl::glBindTexture = nullptr;
+decltype(&::glTexImage2D) gl::glTexImage2D = nullptr;
+decltype(&::glTexSubImage2D) gl::glTexSubImage2D = nullptr;
+decltype(&::glTexParameteri) gl::glTexParameteri = nullptr;
+decltype(&::glReadPixels) gl::glReadPixels = nullptr;
 PFNGLCREATESHADERPROC gl::glCreateShader = nullptr;
 PFNGLSHADERSOURCEARBPROC gl::glShaderSource = nullptr;
 PFNGLCOMPILESHADERARBPROC gl::glCompileShader = nullptr;
@@ -29,12 +90,218 @@ PFNGLVERTEXATTRIBPOINTERPROC gl::glVertexAttribPointer = nullptr;
 PFNGLENABLEVERTEXATTRIBARRAYPROC gl::glEnableVertexAttribArray = nullptr;
 PFNGLDISABLEVERTEXATTRIBARRAYPROC gl::glDisableVertexAttribArray = nullptr;
 PFNGLGETUNIFORMLOCATIONPROC gl::glGetUniformLocation = nullptr;
+PFNGLGETACTIVEUNIFORMPROC gl::glGetActiveUniform = nullptr;
 PFNGLUNIFORM1IPROC gl::glUniform1i = nullptr;
 PFNGLACTIVETEXTUREPROC gl::glActiveTextureMY = nullptr;
 PFNGLUNIFORM4FVPROC gl::glUniform4fv = nullptr;
 PFNGLUNIFORMMATRIX3FVPROC gl::glUniformMatrix3fv = nullptr;
+PFNGLGENBUFFERSPROC gl::glGenBuffers = nullptr;
+PFNGLDELETEBUFFERSPROC gl::glDeleteBuffers = nullptr;
+PFNGLBINDBUFFERPROC gl::glBindBuffer = nullptr;
+PFNGLBUFFERDATAPROC gl::glBufferData = nullptr;
+PFNGLBUFFERSUBDATAPROC gl::glBufferSubData = nullptr;
+PFNGLVERTEXATTRIBDIVISORARBPROC gl::glVertexAttribDivisorARB = nullptr;
+PFNGLDRAWELEMENTSINSTANCEDARBPROC gl::glDrawElementsInstancedARB = nullptr;
+bool gl::has_instanced_arrays = false;
+PFNGLGENFRAMEBUFFERSPROC gl::glGenFramebuffers = nullptr;
+PFNGLDELETEFRAMEBUFFERSPROC gl::glDeleteFramebuffers = nullptr;
+PFNGLBINDFRAMEBUFFERPROC gl::glBindFramebuffer = nullptr;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC gl::glFramebufferRenderbuffer = nullptr;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC gl::glCheckFramebufferStatus = nullptr;
+PFNGLGENRENDERBUFFERSPROC gl::glGenRenderbuffers = nullptr;
+PFNGLDELETERENDERBUFFERSPROC gl::glDeleteRenderbuffers = nullptr;
+PFNGLBINDRENDERBUFFERPROC gl::glBindRenderbuffer = nullptr;
+PFNGLRENDERBUFFERSTORAGEPROC gl::glRenderbufferStorage = nullptr;
+bool gl::has_framebuffer_objects = false;
+PFNGLMAPBUFFERPROC gl::glMapBuffer = nullptr;
+PFNGLUNMAPBUFFERPROC gl::glUnmapBuffer = nullptr;
+bool gl::has_pixel_buffer_objects = false;
+PFNGLGENQUERIESPROC gl::glGenQueries = nullptr;
+PFNGLDELETEQUERIESPROC gl::glDeleteQueries = nullptr;
+PFNGLQUERYCOUNTERPROC gl::glQueryCounter = nullptr;
+PFNGLGETQUERYOBJECTIVPROC gl::glGetQueryObjectiv = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC gl::glGetQueryObjectui64v = nullptr;
+bool gl::has_timer_query = false;
+PFNGLDEBUGMESSAGECALLBACKPROC gl::glDebugMessageCallback = nullptr;
+PFNGLDEBUGMESSAGECONTROLPROC gl::glDebugMessageControl = nullptr;
+bool gl::has_debug_output = false;
+bool gl::strict_checks = TME_GL_CHECKS;
+std::atomic<std::uint32_t> gl::debug_messages{0};
+std::uint32_t gl::null_calls = 0;
+
+template <typename T>
+struct null_gl_func;
+
+/// generic null function: count call, return zero
+template <typename R, typename... Args>
+struct null_gl_func<R(APIENTRY *)(Args...)> {
+  static R APIENTRY call(Args...) {
+    ++gl::null_calls;
+    return R();
+  }
+};
+
+template <typename T>
+static void set_null(T &result) {
+  result = &null_gl_func<T>::call;
+}
+
+// object names must be unique and not 0, and objects must look valid
+// for engine to go on after creating them
+static GLuint null_last_name = 0;
+
+static GLuint APIENTRY null_create_shader(GLenum) {
+  ++gl::null_calls;
+  return ++null_last_name;
+}
+static GLuint APIENTRY null_create_program() {
+  ++gl::null_calls;
+  return ++null_last_name;
+}
+static void APIENTRY null_gen_names(GLsizei n, GLuint *names) {
+  ++gl::null_calls;
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = ++null_last_name;
+  }
+}
+static void APIENTRY null_get_iv(GLuint, GLenum pname, GLint *params) {
+  ++gl::null_calls;
+  *params = (pname == GL_COMPILE_STATUS || pname == GL_LINK_STATUS) ? 1 : 0;
+}
+
+// uniforms declared in source of every null shader, and in shaders
+// attached to every null program, so programs list their active uniforms
+// like real drivers do; arrays are named "name[0]" like there
+static std::map<GLuint, std::vector<std::string>> null_uniforms;
+
+static bool is_name_char(char c) {
+  return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z');
+}
+
+/// words of glsl source, punctuation other than '[' is dropped
+static std::vector<std::string_view> glsl_words(std::string_view src) {
+  std::vector<std::string_view> words;
+  std::size_t i = 0;
+  while (i < src.size()) {
+    if (src[i] == '[') {
+      words.push_back(src.substr(i, 1));
+      ++i;
+    } else if (is_name_char(src[i])) {
+      const std::size_t start = i;
+      while (i < src.size() && is_name_char(src[i])) {
+        ++i;
+      }
+      words.push_back(src.substr(start, i - start));
+    } else {
+      ++i;
+    }
+  }
+  return words;
+}
+
+static void APIENTRY null_shader_source(GLhandleARB shader, GLsizei count,
+                                        const GLcharARB **strings,
+                                        const GLint *lengths) {
+  ++gl::null_calls;
+  std::string src;
+  for (GLsizei i = 0; i < count; ++i) {
+    if (lengths != nullptr && lengths[i] >= 0) {
+      src.append(strings[i], static_cast<std::size_t>(lengths[i]));
+    } else {
+      src.append(strings[i]);
+    }
+  }
+  // uniform [precision] type name [ '[' size ']' ]
+  const std::vector<std::string_view> words = glsl_words(src);
+  std::vector<std::string> &uniforms = null_uniforms[shader];
+  uniforms.clear();
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    if (words[i] != "uniform") {
+      continue;
+    }
+    std::size_t name = i + 2;
+    if (name < words.size() &&
+        (words[i + 1] == "lowp" || words[i + 1] == "mediump" ||
+         words[i + 1] == "highp")) {
+      ++name;
+    }
+    if (name < words.size()) {
+      const bool array = name + 1 < words.size() && words[name + 1] == "[";
+      uniforms.push_back(std::string(words[name]) + (array ? "[0]" : ""));
+    }
+  }
+}
+
+static void APIENTRY null_attach_shader(GLuint program, GLuint shader) {
+  ++gl::null_calls;
+  std::vector<std::string> &uniforms = null_uniforms[program];
+  for (const std::string &u : null_uniforms[shader]) {
+    // same uniform may be declared by both stages
+    if (std::find(uniforms.begin(), uniforms.end(), u) == uniforms.end()) {
+      uniforms.push_back(u);
+    }
+  }
+}
+
+static void APIENTRY null_get_program_iv(GLuint program, GLenum pname,
+                                         GLint *params) {
+  ++gl::null_calls;
+  const std::vector<std::string> &uniforms = null_uniforms[program];
+  if (pname == GL_ACTIVE_UNIFORMS) {
+    *params = static_cast<GLint>(uniforms.size());
+  } else if (pname == GL_ACTIVE_UNIFORM_MAX_LENGTH) {
+    std::size_t length = 0;
+    for (const std::string &u : uniforms) {
+      length = std::max(length, u.size() + 1);
+    }
+    *params = static_cast<GLint>(length);
+  } else {
+    *params = pname == GL_LINK_STATUS ? 1 : 0;
+  }
+}
+
+static void APIENTRY null_get_active_uniform(GLuint program, GLuint index,
+                                             GLsizei buf_size,
+                                             GLsizei *length, GLint *size,
+                                             GLenum *type, GLchar *name) {
+  ++gl::null_calls;
+  const std::string &u = null_uniforms[program].at(index);
+  const std::size_t copied =
+      std::min(u.size(), static_cast<std::size_t>(std::max(buf_size, 1) - 1));
+  std::memcpy(name, u.data(), copied);
+  name[copied] = '\0';
+  if (length != nullptr) {
+    *length = static_cast<GLsizei>(copied);
+  }
+  *size = 1;
+  *type = 0;
+}
+static GLint APIENTRY null_get_uniform_location(GLuint, const GLchar *) {
+  ++gl::null_calls;
+  return static_cast<GLint>(++null_last_name);
+}
+
+void gl::init(proc_loader loader) {
+  gl_loader = loader;
+
+  glGetError = &::glGetError;
+  glEnable = &::glEnable;
+  glDisable = &::glDisable;
+  glBlendFunc = &::glBlendFunc;
+  glViewport = &::glViewport;
+  glClear = &::glClear;
+  glClearColor = &::glClearColor;
+  glDrawArrays = &::glDrawArrays;
+  glDrawElements = &::glDrawElements;
+  glGenTextures = &::glGenTextures;
+  glDeleteTextures = &::glDeleteTextures;
+  glBindTexture = &::glBindTexture;
+  glTexImage2D = &::glTexImage2D;
+  glTexSubImage2D = &::glTexSubImage2D;
+  glTexParameteri = &::glTexParameteri;
+  glReadPixels = &::glReadPixels;
 
-void gl::init() {
   load_gl_func("glCreateShader", glCreateShader);
   load_gl_func("glShaderSource", glShaderSource);
   load_gl_func("glCompileShader", glCompileShader);
@@ -53,9 +320,287 @@ void gl::init() {
   load_gl_func("glEnableVertexAttribArray", glEnableVertexAttribArray);
   load_gl_func("glDisableVertexAttribArray", glDisableVertexAttribArray);
   load_gl_func("glGetUniformLocation", glGetUniformLocation);
+  load_gl_func("glGetActiveUniform", glGetActiveUniform);
   load_gl_func("glUniform1i", glUniform1i);
   load_gl_func("glActiveTexture", glActiveTextureMY);
   load_gl_func("glUniform4fv", glUniform4fv);
   load_gl_func("glUniformMatrix3fv", glUniformMatrix3fv);
+  load_gl_func("glGenBuffers", glGenBuffers);
+  load_gl_func("glDeleteBuffers", glDeleteBuffers);
+  load_gl_func("glBindBuffer", glBindBuffer);
+  load_gl_func("glBufferData", glBufferData);
+  load_gl_func("glBufferSubData", glBufferSubData);
+
+  has_instanced_arrays =
+      extension_supported("GL_ARB_instanced_arrays") &&
+      try_load_gl_func("glVertexAttribDivisorARB", glVertexAttribDivisorARB) &&
+      try_load_gl_func("glDrawElementsInstancedARB",
+                       glDrawElementsInstancedARB);
+
+  // core since OpenGL 3.0, same names in ARB_framebuffer_object
+  has_framebuffer_objects =
+      try_load_gl_func("glGenFramebuffers", glGenFramebuffers) &&
+      try_load_gl_func("glDeleteFramebuffers", glDeleteFramebuffers) &&
+      try_load_gl_func("glBindFramebuffer", glBindFramebuffer) &&
+      try_load_gl_func("glFramebufferRenderbuffer",
+                       glFramebufferRenderbuffer) &&
+      try_load_gl_func("glCheckFramebufferStatus", glCheckFramebufferStatus) &&
+      try_load_gl_func("glGenRenderbuffers", glGenRenderbuffers) &&
+      try_load_gl_func("glDeleteRenderbuffers", glDeleteRenderbuffers) &&
+      try_load_gl_func("glBindRenderbuffer", glBindRenderbuffer) &&
+      try_load_gl_func("glRenderbufferStorage", glRenderbufferStorage);
+
+  // core since OpenGL 2.1
+  has_pixel_buffer_objects =
+      extension_supported("GL_ARB_pixel_buffer_object") &&
+      try_load_gl_func("glMapBuffer", glMapBuffer) &&
+      try_load_gl_func("glUnmapBuffer", glUnmapBuffer);
+
+  // core since OpenGL 3.3
+  has_timer_query =
+      extension_supported("GL_ARB_timer_query") &&
+      try_load_gl_func("glGenQueries", glGenQueries) &&
+      try_load_gl_func("glDeleteQueries", glDeleteQueries) &&
+      try_load_gl_func("glQueryCounter", glQueryCounter) &&
+      try_load_gl_func("glGetQueryObjectiv", glGetQueryObjectiv) &&
+      try_load_gl_func("glGetQueryObjectui64v", glGetQueryObjectui64v);
+
+  // desktop KHR_debug functions have no suffix
+  has_debug_output =
+      extension_supported("GL_KHR_debug") &&
+      try_load_gl_func("glDebugMessageCallback", glDebugMessageCallback) &&
+      try_load_gl_func("glDebugMessageControl", glDebugMessageControl);
+}
+
+void gl::init_null() {
+  set_null(glGetError);
+  set_null(glEnable);
+  set_null(glDisable);
+  set_null(glBlendFunc);
+  set_null(glViewport);
+  set_null(glClear);
+  set_null(glClearColor);
+  set_null(glDrawArrays);
+  set_null(glDrawElements);
+  set_null(glGenTextures);
+  set_null(glDeleteTextures);
+  set_null(glBindTexture);
+  set_null(glTexImage2D);
+  set_null(glTexSubImage2D);
+  set_null(glTexParameteri);
+  set_null(glReadPixels);
+  set_null(glCreateShader);
+  set_null(glShaderSource);
+  set_null(glCompileShader);
+  set_null(glGetShaderiv);
+  set_null(glGetShaderInfoLog);
+  set_null(glDeleteShader);
+  set_null(glCreateProgram);
+  set_null(glAttachShader);
+  set_null(glBindAttribLocation);
+  set_null(glLinkProgram);
+  set_null(glGetProgramiv);
+  set_null(glGetProgramInfoLog);
+  set_null(glDeleteProgram);
+  set_null(glUseProgram);
+  set_null(glVertexAttribPointer);
+  set_null(glEnableVertexAttribArray);
+  set_null(glDisableVertexAttribArray);
+  set_null(glGetUniformLocation);
+  set_null(glGetActiveUniform);
+  set_null(glUniform1i);
+  set_null(glActiveTextureMY);
+  set_null(glUniform4fv);
+  set_null(glUniformMatrix3fv);
+  set_null(glGenBuffers);
+  set_null(glDeleteBuffers);
+  set_null(glBindBuffer);
+  set_null(glBufferData);
+  set_null(glBufferSubData);
+  set_null(glVertexAttribDivisorARB);
+  set_null(glDrawElementsInstancedARB);
+  set_null(glGenFramebuffers);
+  set_null(glDeleteFramebuffers);
+  set_null(glBindFramebuffer);
+  set_null(glFramebufferRenderbuffer);
+  set_null(glCheckFramebufferStatus);
+  set_null(glGenRenderbuffers);
+  set_null(glDeleteRenderbuffers);
+  set_null(glBindRenderbuffer);
+  set_null(glRenderbufferStorage);
+  set_null(glMapBuffer);
+  set_null(glUnmapBuffer);
+  set_null(glGenQueries);
+  set_null(glDeleteQueries);
+  set_null(glQueryCounter);
+  set_null(glGetQueryObjectiv);
+  set_null(glGetQueryObjectui64v);
+  set_null(glDebugMessageCallback);
+  set_null(glDebugMessageControl);
+
+  glCreateShader = null_create_shader;
+  glCreateProgram = null_create_program;
+  glGenTextures = null_gen_names;
+  glGenBuffers = null_gen_names;
+  glGenFramebuffers = null_gen_names;
+  glGenRenderbuffers = null_gen_names;
+  glGetShaderiv = null_get_iv;
+  glShaderSource = null_shader_source;
+  glAttachShader = null_attach_shader;
+  glGetProgramiv = null_get_program_iv;
+  glGetActiveUniform = null_get_active_uniform;
+  glGetUniformLocation = null_get_uniform_location;
+  null_uniforms.clear();
+
+  has_instanced_arrays = false;
+  has_framebuffer_objects = false;
+  has_pixel_buffer_objects = false;
+  has_timer_query = false;
+  has_debug_output = false;
+  null_calls = 0;
+}
+
+static const char *error_name(GLenum error) {
+  switch (error) {
+  case GL_INVALID_ENUM:
+    return "GL_INVALID_ENUM";
+  case GL_INVALID_VALUE:
+    return "GL_INVALID_VALUE";
+  case GL_INVALID_OPERATION:
+    return "GL_INVALID_OPERATION";
+  case GL_INVALID_FRAMEBUFFER_OPERATION:
+    return "GL_INVALID_FRAMEBUFFER_OPERATION";
+  case GL_OUT_OF_MEMORY:
+    return "GL_OUT_OF_MEMORY";
+  case GL_STACK_OVERFLOW:
+    return "GL_STACK_OVERFLOW";
+  case GL_STACK_UNDERFLOW:
+    return "GL_STACK_UNDERFLOW";
+  }
+  return "unknown gl error";
+}
+
+void gl::check_error(const char *file, int line) {
+  bool failed = false;
+  // several error flags may be set, each call returns and clears one
+  for (GLenum err = glGetError(); err != GL_NO_ERROR; err = glGetError()) {
+    std::cerr << file << ':' << line << ": " << error_name(err) << std::endl;
+    failed = true;
+  }
+  assert(!failed);
+  (void)failed;
+}
+
+static const char *debug_source_name(GLenum source) {
+  switch (source) {
+  case GL_DEBUG_SOURCE_API:
+    return "api";
+  case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+    return "window_system";
+  case GL_DEBUG_SOURCE_SHADER_COMPILER:
+    return "shader_compiler";
+  case GL_DEBUG_SOURCE_THIRD_PARTY:
+    return "third_party";
+  case GL_DEBUG_SOURCE_APPLICATION:
+    return "application";
+  }
+  return "other";
+}
+
+static const char *debug_type_name(GLenum type) {
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:
+    return "error";
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+    return "deprecated";
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+    return "undefined";
+  case GL_DEBUG_TYPE_PORTABILITY:
+    return "portability";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "performance";
+  }
+  return "other";
+}
+
+static const char *debug_severity_name(GLenum severity) {
+  switch (severity) {
+  case GL_DEBUG_SEVERITY_HIGH:
+    return "high";
+  case GL_DEBUG_SEVERITY_MEDIUM:
+    return "medium";
+  case GL_DEBUG_SEVERITY_LOW:
+    return "low";
+  }
+  return "notification";
+}
+
+// may be called from driver thread if output is not synchronous
+static void APIENTRY debug_callback(GLenum source, GLenum type, GLuint id,
+                                    GLenum severity, GLsizei length,
+                                    const GLchar *message, const void *) {
+  ++gl::debug_messages;
+  std::string_view text(message);
+  if (length >= 0) {
+    text = std::string_view(message, static_cast<std::size_t>(length));
+  }
+  std::cerr << "gl " << debug_source_name(source) << ' '
+            << debug_type_name(type) << ' ' << debug_severity_name(severity)
+            << ' ' << id << ": " << text << std::endl;
+}
+
+static GLenum to_gl(gl_debug_source source) {
+  switch (source) {
+  case gl_debug_source::all:
+    break;
+  case gl_debug_source::api:
+    return GL_DEBUG_SOURCE_API;
+  case gl_debug_source::window_system:
+    return GL_DEBUG_SOURCE_WINDOW_SYSTEM;
+  case gl_debug_source::shader_compiler:
+    return GL_DEBUG_SOURCE_SHADER_COMPILER;
+  case gl_debug_source::third_party:
+    return GL_DEBUG_SOURCE_THIRD_PARTY;
+  case gl_debug_source::application:
+    return GL_DEBUG_SOURCE_APPLICATION;
+  case gl_debug_source::other:
+    return GL_DEBUG_SOURCE_OTHER;
+  }
+  return GL_DONT_CARE;
+}
+
+bool gl::set_debug_mode(gl_debug_mode mode, const gl_debug_filter &filter) {
+  strict_checks = TME_GL_CHECKS && mode == gl_debug_mode::strict;
+  debug_messages = 0;
+
+  if (!has_debug_output) {
+    return mode == gl_debug_mode::off ||
+           (mode == gl_debug_mode::strict && TME_GL_CHECKS);
+  }
+  if (mode == gl_debug_mode::off) {
+    glDisable(GL_DEBUG_OUTPUT);
+    return true;
+  }
+
+  // filtered messages are dropped by driver, callback never sees them
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
+                        GL_FALSE);
+  const GLenum severities[] = {GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM,
+                               GL_DEBUG_SEVERITY_LOW,
+                               GL_DEBUG_SEVERITY_NOTIFICATION};
+  const std::size_t count = static_cast<std::size_t>(filter.severity) + 1;
+  for (std::size_t i = 0; i < count; ++i) {
+    glDebugMessageControl(to_gl(filter.source), GL_DONT_CARE, severities[i],
+                          0, nullptr, GL_TRUE);
+  }
+  glDebugMessageCallback(&debug_callback, nullptr);
+  glEnable(GL_DEBUG_OUTPUT);
+  // strict mode wants message printed before check_error of same call
+  if (mode == gl_debug_mode::strict) {
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  } else {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+  return mode == gl_debug_mode::callback || TME_GL_CHECKS;
 }
 } // namespace tme
@@ -0,0 +1,171 @@
+#include "gl_state.hxx"
+#include "gl_init.hxx"
+
+namespace tme {
+
+std::uint32_t gl_state::calls_issued = 0;
+std::uint32_t gl_state::calls_skipped = 0;
+
+GLuint gl_state::program = 0;
+GLuint gl_state::active_unit = 0;
+std::array<GLuint, gl_state::max_texture_units> gl_state::textures{};
+GLuint gl_state::array_buffer = 0;
+GLuint gl_state::element_buffer = 0;
+std::uint32_t gl_state::attrib_mask = 0;
+bool gl_state::blend_enabled = false;
+GLenum gl_state::blend_src = GL_ONE;
+GLenum gl_state::blend_dst = GL_ZERO;
+std::array<GLint, 4> gl_state::viewport_rect{{-1, -1, -1, -1}};
+
+void gl_state::reset() {
+  // defaults of just created context from gl specification
+  program = 0;
+  active_unit = 0;
+  textures.fill(0);
+  array_buffer = 0;
+  element_buffer = 0;
+  attrib_mask = 0;
+  blend_enabled = false;
+  blend_src = GL_ONE;
+  blend_dst = GL_ZERO;
+  // viewport depends on window, so first call always goes to gl
+  viewport_rect.fill(-1);
+  calls_issued = 0;
+  calls_skipped = 0;
+}
+
+void gl_state::use_program(GLuint program_) {
+  if (program == program_) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glUseProgram(program_);
+  GL_CHECK();
+  program = program_;
+  ++calls_issued;
+}
+
+void gl_state::active_texture(GLuint unit) {
+  if (active_unit == unit) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glActiveTextureMY(GL_TEXTURE0 + unit);
+  GL_CHECK();
+  active_unit = unit;
+  ++calls_issued;
+}
+
+void gl_state::bind_texture(GLuint unit, GLuint texture) {
+  assert(unit < max_texture_units);
+  if (textures[unit] == texture) {
+    ++calls_skipped;
+    return;
+  }
+  active_texture(unit);
+  gl::glBindTexture(GL_TEXTURE_2D, texture);
+  GL_CHECK();
+  textures[unit] = texture;
+  ++calls_issued;
+}
+
+void gl_state::bind_array_buffer(GLuint buffer) {
+  if (array_buffer == buffer) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  GL_CHECK();
+  array_buffer = buffer;
+  ++calls_issued;
+}
+
+void gl_state::bind_element_buffer(GLuint buffer) {
+  if (element_buffer == buffer) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+  GL_CHECK();
+  element_buffer = buffer;
+  ++calls_issued;
+}
+
+void gl_state::enable_attribs(std::uint32_t mask) {
+  for (std::uint32_t i = 0; i < max_attribs; ++i) {
+    const std::uint32_t bit = 1u << i;
+    if ((attrib_mask & bit) == (mask & bit)) {
+      if (mask & bit) {
+        ++calls_skipped;
+      }
+      continue;
+    }
+    if (mask & bit) {
+      gl::glEnableVertexAttribArray(i);
+    } else {
+      gl::glDisableVertexAttribArray(i);
+    }
+    GL_CHECK();
+    ++calls_issued;
+  }
+  attrib_mask = mask;
+}
+
+void gl_state::blend(bool enabled) {
+  if (blend_enabled == enabled) {
+    ++calls_skipped;
+    return;
+  }
+  if (enabled) {
+    gl::glEnable(GL_BLEND);
+  } else {
+    gl::glDisable(GL_BLEND);
+  }
+  GL_CHECK();
+  blend_enabled = enabled;
+  ++calls_issued;
+}
+
+void gl_state::blend_func(GLenum src, GLenum dst) {
+  if (blend_src == src && blend_dst == dst) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glBlendFunc(src, dst);
+  GL_CHECK();
+  blend_src = src;
+  blend_dst = dst;
+  ++calls_issued;
+}
+
+void gl_state::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  const std::array<GLint, 4> rect{{x, y, width, height}};
+  if (viewport_rect == rect) {
+    ++calls_skipped;
+    return;
+  }
+  gl::glViewport(x, y, width, height);
+  GL_CHECK();
+  viewport_rect = rect;
+  ++calls_issued;
+}
+
+void gl_state::forget_texture(GLuint texture) {
+  // deleted texture is unbound from every unit by gl itself
+  for (GLuint &t : textures) {
+    if (t == texture) {
+      t = 0;
+    }
+  }
+}
+
+void gl_state::forget_buffer(GLuint buffer) {
+  if (array_buffer == buffer) {
+    array_buffer = 0;
+  }
+  if (element_buffer == buffer) {
+    element_buffer = 0;
+  }
+}
+
+} // namespace tme
@@ -0,0 +1,100 @@
+#include "gpu_timer.hxx"
+#include <algorithm>
+#include <numeric>
+
+namespace tme {
+
+gpu_timer::gpu_timer() {
+  assert(gl::has_timer_query);
+  for (frame_queries &f : ring) {
+    gl::glGenQueries(mark_count, f.queries.data());
+    GL_CHECK();
+  }
+}
+
+gpu_timer::~gpu_timer() {
+  for (frame_queries &f : ring) {
+    gl::glDeleteQueries(mark_count, f.queries.data());
+    GL_CHECK();
+  }
+}
+
+void gpu_timer::set_mark(mark m) {
+  gl::glQueryCounter(ring[current].queries[m], GL_TIMESTAMP);
+  GL_CHECK();
+}
+
+bool gpu_timer::read(frame_queries &f) {
+  // timestamps complete in order, so last one tells about all
+  GLint available = 0;
+  gl::glGetQueryObjectiv(f.queries[frame_end], GL_QUERY_RESULT_AVAILABLE,
+                         &available);
+  GL_CHECK();
+  if (available == 0) {
+    return false;
+  }
+
+  std::array<GLuint64, mark_count> ns{};
+  for (std::size_t i = 0; i < mark_count; ++i) {
+    gl::glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &ns[i]);
+    GL_CHECK();
+  }
+  auto ms = [&](mark from, mark to) {
+    return ns[to] > ns[from] ? static_cast<float>(ns[to] - ns[from]) * 1e-6f
+                             : 0.f;
+  };
+  history[0][history_next] = ms(frame_begin, scene_end);
+  history[1][history_next] = ms(scene_end, queue_end);
+  history[2][history_next] = ms(queue_end, frame_end);
+  history[3][history_next] = ms(frame_begin, frame_end);
+  history_next = (history_next + 1) % history_size;
+  history_count = std::min(history_count + 1, history_size);
+  return true;
+}
+
+void gpu_timer::end_frame() {
+  ring[current].pending = true;
+  // oldest first, keeps history in frame order
+  for (std::size_t i = 1; i <= latency; ++i) {
+    frame_queries &f = ring[(current + i) % latency];
+    if (f.pending && read(f)) {
+      f.pending = false;
+    } else if (f.pending) {
+      break;
+    }
+  }
+  current = (current + 1) % latency;
+  // still not ready after latency frames, drop it instead of waiting
+  ring[current].pending = false;
+}
+
+gpu_pass_stats
+gpu_timer::summarize(const std::array<float, history_size> &ms,
+                     std::size_t count) {
+  gpu_pass_stats result;
+  if (count == 0) {
+    return result;
+  }
+  std::array<float, history_size> sorted = ms;
+  std::sort(sorted.begin(), sorted.begin() + count);
+  result.min_ms = sorted[0];
+  result.avg_ms =
+      std::accumulate(sorted.begin(), sorted.begin() + count, 0.f) / count;
+  // nearest rank
+  const std::size_t rank = (99 * count + 99) / 100;
+  result.p99_ms = sorted[rank - 1];
+  return result;
+}
+
+gpu_stats gpu_timer::get_stats() const {
+  gpu_stats result;
+  result.available = true;
+  result.frames = static_cast<std::uint32_t>(history_count);
+  result.scene = summarize(history[0], history_count);
+  result.queue = summarize(history[1], history_count);
+  result.present = summarize(history[2], history_count);
+  result.frame = summarize(history[3], history_count);
+  return result;
+}
+
+} // namespace tme
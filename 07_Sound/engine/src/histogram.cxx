@@ -0,0 +1,61 @@
+#include "histogram.hxx"
+#include <algorithm>
+#include <cmath>
+
+namespace tme {
+
+std::size_t latency_histogram::bucket_of(std::uint64_t us) {
+  if (us < 2 * sub_count) {
+    return static_cast<std::size_t>(us);
+  }
+  // shift so us >> shift is in [sub_count, 2 * sub_count)
+  std::uint32_t shift = 0;
+  while ((us >> shift) >= 2 * sub_count) {
+    ++shift;
+  }
+  if (shift > max_shift) {
+    return bucket_count - 1;
+  }
+  return 2 * sub_count + (shift - 1) * sub_count +
+         static_cast<std::size_t>((us >> shift) - sub_count);
+}
+
+std::uint64_t latency_histogram::value_of(std::size_t bucket) {
+  if (bucket < 2 * sub_count) {
+    return bucket;
+  }
+  const std::size_t shift = (bucket - 2 * sub_count) / sub_count + 1;
+  const std::uint64_t sub = (bucket - 2 * sub_count) % sub_count + sub_count;
+  // highest value that falls into bucket
+  return ((sub + 1) << shift) - 1;
+}
+
+void latency_histogram::record(std::uint64_t us) {
+  ++buckets[bucket_of(us)];
+  ++count;
+  max = std::max(max, us);
+}
+
+std::uint64_t latency_histogram::percentile(double fraction) const {
+  if (count == 0) {
+    return 0;
+  }
+  const std::uint64_t rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(fraction * count)));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < bucket_count; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(value_of(i), max);
+    }
+  }
+  return max;
+}
+
+void latency_histogram::reset() {
+  buckets.fill(0);
+  count = 0;
+  max = 0;
+}
+
+} // namespace tme
@@ -0,0 +1,95 @@
+#include "instancing.hxx"
+#include "gl_init.hxx"
+#include "gl_state.hxx"
+#include <cstddef>
+
+namespace tme {
+
+static_assert(offsetof(instance, uv_scale) ==
+                  offsetof(instance, uv_offset) + sizeof(vec2),
+              "uv offset and scale are read as one vec4 attribute");
+
+instance_renderer::instance_renderer(shader_gl_es20 *shader_)
+    : shader(shader_) {
+  assert(shader != nullptr);
+  assert(gl::has_instanced_arrays);
+  u_texture = shader->get_uniform("s_texture");
+  u_uv_rect = shader->get_uniform("u_uv_rect");
+
+  gl::glGenBuffers(1, &vbo);
+  GL_CHECK();
+
+  // without vertex array objects divisor is global state, attributes 3..7
+  // are used only by instancing shader so set it once
+  for (GLuint attr = 3; attr <= 7; ++attr) {
+    gl::glVertexAttribDivisorARB(attr, 1);
+    GL_CHECK();
+  }
+}
+
+instance_renderer::~instance_renderer() {
+  gl_state::forget_buffer(vbo);
+  gl::glDeleteBuffers(1, &vbo);
+  GL_CHECK();
+}
+
+void instance_renderer::render(mesh_gl_es20 *msh, texture_gl_es20 *tex,
+                               const instance *instances, std::size_t count) {
+  assert(msh != nullptr);
+  if (count == 0) {
+    return;
+  }
+
+  shader->use();
+  shader->set_uniform(u_texture, tex);
+  shader->set_uniform(u_uv_rect, tex->get_uv_rect());
+
+  msh->bind();
+
+  gl_state::bind_array_buffer(vbo);
+  const std::size_t size = count * sizeof(instance);
+  if (count > capacity) {
+    capacity = count;
+    gl::glBufferData(GL_ARRAY_BUFFER, size, instances, GL_STREAM_DRAW);
+  } else {
+    // orphan previous storage so driver doesn't wait for last draw
+    gl::glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(instance), nullptr,
+                     GL_STREAM_DRAW);
+    GL_CHECK();
+    gl::glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances);
+  }
+  GL_CHECK();
+
+  // matrix rows
+  gl::glVertexAttribPointer(
+      3, 2, GL_FLOAT, GL_FALSE, sizeof(instance),
+      reinterpret_cast<GLvoid *>(offsetof(instance, m) + 0 * sizeof(vec2)));
+  GL_CHECK();
+  gl::glVertexAttribPointer(
+      4, 2, GL_FLOAT, GL_FALSE, sizeof(instance),
+      reinterpret_cast<GLvoid *>(offsetof(instance, m) + 1 * sizeof(vec2)));
+  GL_CHECK();
+  gl::glVertexAttribPointer(
+      5, 2, GL_FLOAT, GL_FALSE, sizeof(instance),
+      reinterpret_cast<GLvoid *>(offsetof(instance, m) + 2 * sizeof(vec2)));
+  GL_CHECK();
+
+  // color
+  gl::glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(instance),
+                            reinterpret_cast<GLvoid *>(offsetof(instance, c)));
+  GL_CHECK();
+
+  // uv offset and scale
+  gl::glVertexAttribPointer(
+      7, 4, GL_FLOAT, GL_FALSE, sizeof(instance),
+      reinterpret_cast<GLvoid *>(offsetof(instance, uv_offset)));
+  GL_CHECK();
+  gl_state::enable_attribs(0xff);
+
+  gl::glDrawElementsInstancedARB(
+      GL_TRIANGLES, static_cast<GLsizei>(msh->get_index_count()),
+      GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(count));
+  GL_CHECK();
+}
+
+} // namespace tme
@@ -1,54 +1,41 @@
-#include "engine.hxx"
-#include <cmath>
-namespace tme {
-
-mat3x2::mat3x2() : raw{vec2()} {}
-
-const mat3x2 mat3x2::identity() { return mat3x2::scale(1.f); }
-
-const mat3x2 mat3x2::scale(const float &scale) {
-  mat3x2 result;
-  result.raw[0].x = scale;
-  result.raw[1].y = scale;
-  return result;
-}
-
-const mat3x2 mat3x2::rotation(const float &thetha) {
-  mat3x2 result;
-
-  result.raw[0].x = std::cos(thetha);
-  result.raw[1].x = std::sin(thetha);
+// libengine keeps exported copies of inline math of math.hxx for binaries
+// built against older libengine. pe targets emit inline functions marked
+// TME_DECLSPEC themselves; elf needs them odr-used here: functions by
+// address, constructors by calls, which stay calls because this file is
+// built without inlining (see CMakeLists.txt)
+#include "math.hxx"
 
-  result.raw[0].y = -std::sin(thetha);
-  result.raw[1].y = std::cos(thetha);
-
-  return result;
-}
+namespace tme {
 
-const mat3x2 mat3x2::movement(const tme::vec2 &offset) {
-  mat3x2 result = mat3x2::identity();
-  result.raw[2].x = offset.x;
-  result.raw[2].y = offset.y;
-  return result;
+const std::vector<float> mat3x2::get_floats() const {
+  const std::array<float, 9> values = get_column_major();
+  return std::vector<float>(values.begin(), values.end());
 }
 
-const mat3x2 mat3x2::match_640x480() {
-  mat3x2 result;
-  result.raw[0].x = 1;
-  result.raw[1].y = 640.f / 480.f;
-  return result;
+struct math_exports {
+  vec2 (*add)(const vec2 &, const vec2 &);
+  vec2 (*multiply)(const float &, const vec2 &);
+  vec2 (*transform)(const vec2 &, const mat3x2 &);
+  mat3x2 (*combine)(const mat3x2 &, const mat3x2 &);
+  const mat3x2 (*identity)();
+  const mat3x2 (*scale)(const float &);
+  const mat3x2 (*rotation)(const float &);
+  const mat3x2 (*movement)(const vec2 &);
+  const mat3x2 (*match_640x480)();
+  void (*construct)(vec2 &, vec2 &, mat3x2 &);
+};
+
+static void construct(vec2 &zero, vec2 &v, mat3x2 &m) {
+  zero = vec2();
+  v = vec2(v.y, v.x);
+  m = mat3x2();
 }
 
-const std::vector<float> mat3x2::get_floats() const {
-  std::vector<float> result;
-  for (int i = 0; i < 3; ++i)
-    result.push_back(raw[i].x);
-  for (int i = 0; i < 3; ++i)
-    result.push_back(raw[i].y);
-  result.push_back(0);
-  result.push_back(0);
-  result.push_back(1);
+extern const math_exports kept_math_exports;
+const math_exports kept_math_exports = {
+    &operator+,          &operator*,        &operator*,
+    &operator*,          &mat3x2::identity, &mat3x2::scale,
+    &mat3x2::rotation,   &mat3x2::movement, &mat3x2::match_640x480,
+    &construct};
 
-  return result;
-}
 } // namespace tme
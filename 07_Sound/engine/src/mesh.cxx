@@ -0,0 +1,79 @@
+#include "mesh.hxx"
+#include "gl_init.hxx"
+#include "gl_state.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace tme {
+
+mesh_gl_es20::mesh_gl_es20(const std::vector<v2> &vertices_,
+                           const std::vector<std::uint16_t> &indices_)
+    : vertex_count(vertices_.size()), index_count(indices_.size()) {
+  if (vertices_.empty() || indices_.empty() || indices_.size() % 3 != 0) {
+    throw std::runtime_error("mesh needs vertices and whole triangles");
+  }
+  if (vertices_.size() > std::numeric_limits<std::uint16_t>::max() + 1u) {
+    throw std::runtime_error("too many vertices for 16 bit indices");
+  }
+  if (*std::max_element(indices_.begin(), indices_.end()) >=
+      vertices_.size()) {
+    throw std::runtime_error("mesh index out of vertices range");
+  }
+  const std::uint16_t quad_indices[6] = {0, 1, 2, 0, 2, 3};
+  quad = vertices_.size() == 4 && indices_.size() == 6 &&
+         std::equal(indices_.begin(), indices_.end(), quad_indices);
+
+  gl::glGenBuffers(1, &vbo);
+  GL_CHECK();
+  gl_state::bind_array_buffer(vbo);
+  gl::glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(v2),
+                   vertices_.data(), GL_STATIC_DRAW);
+  GL_CHECK();
+
+  gl::glGenBuffers(1, &ibo);
+  GL_CHECK();
+  gl_state::bind_element_buffer(ibo);
+  gl::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   indices_.size() * sizeof(std::uint16_t), indices_.data(),
+                   GL_STATIC_DRAW);
+  GL_CHECK();
+
+  // read only by cpu instancing fallback and software rasterizer, which
+  // runs on null gl, so never with instanced arrays
+  if (!gl::has_instanced_arrays) {
+    vertices = vertices_;
+    indices = indices_;
+  }
+}
+
+mesh_gl_es20::~mesh_gl_es20() {
+  gl_state::forget_buffer(vbo);
+  gl_state::forget_buffer(ibo);
+  GLuint buffers[2] = {vbo, ibo};
+  gl::glDeleteBuffers(2, buffers);
+  GL_CHECK();
+}
+
+void mesh_gl_es20::bind() const {
+  gl_state::bind_array_buffer(vbo);
+  gl_state::bind_element_buffer(ibo);
+
+  // positions
+  gl::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, pos)));
+  GL_CHECK();
+
+  // colors
+  gl::glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, c)));
+  GL_CHECK();
+
+  // texture coordinates
+  gl::glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(v2),
+                            reinterpret_cast<GLvoid *>(offsetof(v2, uv)));
+  GL_CHECK();
+  gl_state::enable_attribs(0b111);
+}
+
+} // namespace tme
@@ -0,0 +1,215 @@
+#include "mipmap.hxx"
+#include "profiler.hxx"
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tme {
+
+std::uint32_t mip_levels(std::uint32_t width, std::uint32_t height) {
+  std::uint32_t levels = 1;
+  for (std::uint32_t size = std::max(width, height); size > 1; size /= 2) {
+    ++levels;
+  }
+  return levels;
+}
+
+std::size_t mip_chain_size(std::uint32_t width, std::uint32_t height,
+                           std::uint32_t levels) {
+  std::size_t size = 0;
+  for (std::uint32_t level = 0; level < levels; ++level) {
+    size += std::size_t{4} * mip_size(width, level) * mip_size(height, level);
+  }
+  return size;
+}
+
+// texels are averaged as r * w, g * w, b * w, w in linear light with
+// w = max(alpha, min_weight): visible texels outweigh transparent ones,
+// fully transparent areas still keep their color; w rounds to alpha 0
+static constexpr float min_weight = 1.f / 4096.f;
+// linear light steps of srgb encode table
+static constexpr std::size_t encode_steps = 8192;
+
+struct srgb_tables {
+  float decode[256];
+  unsigned char encode[encode_steps];
+
+  srgb_tables() {
+    for (std::size_t i = 0; i < 256; ++i) {
+      const float c = static_cast<float>(i) / 255.f;
+      decode[i] = c <= 0.04045f ? c / 12.92f
+                                : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (std::size_t i = 0; i < encode_steps; ++i) {
+      const float l = static_cast<float>(i) / (encode_steps - 1);
+      const float c = l <= 0.0031308f
+                          ? l * 12.92f
+                          : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+      encode[i] = static_cast<unsigned char>(c * 255.f + 0.5f);
+    }
+  }
+};
+
+static const srgb_tables &get_srgb_tables() {
+  static const srgb_tables tables;
+  return tables;
+}
+
+#if defined(__SSE2__)
+// whole texel in one register
+using texel = __m128;
+
+static texel texel_zero() { return _mm_setzero_ps(); }
+static texel texel_add(texel a, texel b) { return _mm_add_ps(a, b); }
+static texel texel_scale(texel a, float s) {
+  return _mm_mul_ps(a, _mm_set1_ps(s));
+}
+static texel texel_load(const float *p) { return _mm_loadu_ps(p); }
+static void texel_store(float *p, texel t) { _mm_storeu_ps(p, t); }
+
+static texel texel_from_srgb(const srgb_tables &tables,
+                             const unsigned char *p) {
+  const float w = std::max(p[3] * (1.f / 255.f), min_weight);
+  const texel linear = _mm_set_ps(1.f, tables.decode[p[2]],
+                                  tables.decode[p[1]], tables.decode[p[0]]);
+  return _mm_mul_ps(linear, _mm_set1_ps(w));
+}
+
+static void texel_to_srgb(const srgb_tables &tables, texel t,
+                          unsigned char *p) {
+  const texel w = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 3, 3));
+  const texel rgb_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  // r, g, b divided by weight, alpha is weight itself
+  texel v = _mm_or_ps(_mm_and_ps(rgb_mask, _mm_div_ps(t, w)),
+                      _mm_andnot_ps(rgb_mask, t));
+  const float steps = static_cast<float>(encode_steps - 1);
+  v = _mm_mul_ps(v, _mm_set_ps(255.f, steps, steps, steps));
+  v = _mm_min_ps(_mm_add_ps(v, _mm_set1_ps(0.5f)),
+                 _mm_set_ps(255.f, steps, steps, steps));
+  alignas(16) std::int32_t index[4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(index), _mm_cvttps_epi32(v));
+  p[0] = tables.encode[index[0]];
+  p[1] = tables.encode[index[1]];
+  p[2] = tables.encode[index[2]];
+  p[3] = static_cast<unsigned char>(index[3]);
+}
+#else
+struct texel {
+  float v[4];
+};
+
+static texel texel_zero() { return texel{{0.f, 0.f, 0.f, 0.f}}; }
+static texel texel_add(texel a, texel b) {
+  for (std::size_t i = 0; i < 4; ++i) {
+    a.v[i] += b.v[i];
+  }
+  return a;
+}
+static texel texel_scale(texel a, float s) {
+  for (float &c : a.v) {
+    c *= s;
+  }
+  return a;
+}
+static texel texel_load(const float *p) {
+  return texel{{p[0], p[1], p[2], p[3]}};
+}
+static void texel_store(float *p, texel t) {
+  std::copy(t.v, t.v + 4, p);
+}
+
+static texel texel_from_srgb(const srgb_tables &tables,
+                             const unsigned char *p) {
+  const float w = std::max(p[3] * (1.f / 255.f), min_weight);
+  return texel{{tables.decode[p[0]] * w, tables.decode[p[1]] * w,
+                tables.decode[p[2]] * w, w}};
+}
+
+static void texel_to_srgb(const srgb_tables &tables, texel t,
+                          unsigned char *p) {
+  const float steps = static_cast<float>(encode_steps - 1);
+  for (std::size_t i = 0; i < 3; ++i) {
+    const float c = std::min(t.v[i] / t.v[3] * steps + 0.5f, steps);
+    p[i] = tables.encode[static_cast<std::size_t>(c)];
+  }
+  p[3] = static_cast<unsigned char>(std::min(t.v[3] * 255.f + 0.5f, 255.f));
+}
+#endif
+
+// one level down: fetch(x, y) gives weighted linear texel of level above,
+// result goes to linear texels of this level and to its srgb pixels
+template <typename fetch_texel>
+static void downsample(const srgb_tables &tables, std::uint32_t in_width,
+                       std::uint32_t in_height, fetch_texel fetch,
+                       float *linear, unsigned char *rgba) {
+  const std::uint32_t width = std::max(1u, in_width / 2);
+  const std::uint32_t height = std::max(1u, in_height / 2);
+  for (std::uint32_t y = 0; y < height; ++y) {
+    // last row takes odd row left over
+    const std::uint32_t y0 = std::min(2 * y, in_height - 1);
+    const std::uint32_t y1 = y + 1 == height ? in_height : 2 * y + 2;
+    for (std::uint32_t x = 0; x < width; ++x) {
+      const std::uint32_t x0 = std::min(2 * x, in_width - 1);
+      const std::uint32_t x1 = x + 1 == width ? in_width : 2 * x + 2;
+      texel sum;
+      if (x1 - x0 == 2 && y1 - y0 == 2) {
+        // all but last row and column
+        sum = texel_add(texel_add(fetch(x0, y0), fetch(x0 + 1, y0)),
+                        texel_add(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1)));
+        sum = texel_scale(sum, 0.25f);
+      } else {
+        sum = texel_zero();
+        for (std::uint32_t sy = y0; sy < y1; ++sy) {
+          for (std::uint32_t sx = x0; sx < x1; ++sx) {
+            sum = texel_add(sum, fetch(sx, sy));
+          }
+        }
+        sum = texel_scale(sum,
+                          1.f / static_cast<float>((y1 - y0) * (x1 - x0)));
+      }
+      const std::size_t i = std::size_t{width} * y + x;
+      // in place from level above is safe, texels read later lie further
+      texel_store(linear + 4 * i, sum);
+      texel_to_srgb(tables, sum, rgba + 4 * i);
+    }
+  }
+}
+
+void generate_mips(unsigned char *chain, std::uint32_t width,
+                   std::uint32_t height, std::uint32_t levels) {
+  if (levels < 2) {
+    return;
+  }
+  TME_PROFILE_SCOPE("generate mips");
+  const srgb_tables &tables = get_srgb_tables();
+  // kept per thread, loader workers make mips of many textures
+  static thread_local std::vector<float> linear;
+  linear.resize(std::size_t{4} * mip_size(width, 1) * mip_size(height, 1));
+
+  const unsigned char *top = chain;
+  unsigned char *level_pixels = chain + std::size_t{4} * width * height;
+  downsample(
+      tables, width, height,
+      [&](std::uint32_t x, std::uint32_t y) {
+        return texel_from_srgb(tables, top + 4 * (std::size_t{width} * y + x));
+      },
+      linear.data(), level_pixels);
+
+  for (std::uint32_t level = 2; level < levels; ++level) {
+    const std::uint32_t in_width = mip_size(width, level - 1);
+    const std::uint32_t in_height = mip_size(height, level - 1);
+    level_pixels += std::size_t{4} * in_width * in_height;
+    const float *above = linear.data();
+    downsample(
+        tables, in_width, in_height,
+        [&](std::uint32_t x, std::uint32_t y) {
+          return texel_load(above + 4 * (std::size_t{in_width} * y + x));
+        },
+        linear.data(), level_pixels);
+  }
+}
+
+} // namespace tme
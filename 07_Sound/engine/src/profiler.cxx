@@ -0,0 +1,146 @@
+#include "profiler.hxx"
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace tme {
+
+std::atomic<bool> profiler::enabled{false};
+
+namespace {
+struct profile_event {
+  const char *name;
+  std::uint64_t begin_ns;
+  std::uint64_t end_ns;
+};
+
+/// event as stored in ring: write_chrome_trace may read slot while owner
+/// thread rewrites it, so fields are relaxed atomics, not plain data
+struct ring_slot {
+  std::atomic<const char *> name{nullptr};
+  std::atomic<std::uint64_t> begin_ns{0};
+  std::atomic<std::uint64_t> end_ns{0};
+};
+
+/// written only by its thread, read by write_chrome_trace
+struct thread_ring {
+  static constexpr std::uint64_t capacity = 1 << 16;
+  std::uint32_t thread_index = 0;
+  // count of events ever written, next one goes to head % capacity
+  std::atomic<std::uint64_t> head{0};
+  ring_slot events[capacity];
+};
+} // namespace
+
+// rings outlive their threads, so events of finished threads are kept
+static std::mutex rings_mutex;
+static std::vector<std::shared_ptr<thread_ring>> rings;
+
+static thread_ring &current_ring() {
+  thread_local std::shared_ptr<thread_ring> ring = [] {
+    auto result = std::make_shared<thread_ring>();
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    result->thread_index = static_cast<std::uint32_t>(rings.size());
+    rings.push_back(result);
+    return result;
+  }();
+  return *ring;
+}
+
+std::uint64_t profiler::now() {
+  using namespace std::chrono;
+  const auto ns =
+      duration_cast<nanoseconds>(steady_clock::now().time_since_epoch());
+  return static_cast<std::uint64_t>(ns.count()) | 1;
+}
+
+void profiler::record(const char *name, std::uint64_t begin_ns,
+                      std::uint64_t end_ns) {
+  thread_ring &ring = current_ring();
+  const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+  // reader that sees any field below sees head of previous record too
+  std::atomic_thread_fence(std::memory_order_release);
+  ring_slot &slot = ring.events[head % thread_ring::capacity];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+static void write_json_string(std::ostream &out, const char *s) {
+  out << '"';
+  for (; *s != 0; ++s) {
+    if (*s == '"' || *s == '\\') {
+      out << '\\';
+    }
+    out << *s;
+  }
+  out << '"';
+}
+
+bool profiler::write_chrome_trace(std::string_view path) {
+  std::vector<std::shared_ptr<thread_ring>> all;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    all = rings;
+  }
+
+  std::vector<std::pair<std::uint32_t, profile_event>> copied;
+  std::uint64_t first_ns = ~std::uint64_t{0};
+  for (const std::shared_ptr<thread_ring> &ring : all) {
+    const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+    const std::uint64_t count = std::min(head, thread_ring::capacity);
+    const std::size_t start = copied.size();
+    for (std::uint64_t i = head - count; i < head; ++i) {
+      const ring_slot &slot = ring->events[i % thread_ring::capacity];
+      copied.emplace_back(
+          ring->thread_index,
+          profile_event{slot.name.load(std::memory_order_relaxed),
+                        slot.begin_ns.load(std::memory_order_relaxed),
+                        slot.end_ns.load(std::memory_order_relaxed)});
+    }
+    // owner thread may have overwritten oldest events while we copied;
+    // slot of event head_after may be half written, so it is dropped too
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::uint64_t head_after =
+        ring->head.load(std::memory_order_relaxed);
+    const std::uint64_t first_valid =
+        head_after >= thread_ring::capacity
+            ? head_after - thread_ring::capacity + 1
+            : 0;
+    const std::uint64_t overwritten =
+        first_valid > head - count
+            ? std::min(count, first_valid - (head - count))
+            : 0;
+    copied.erase(copied.begin() + static_cast<std::ptrdiff_t>(start),
+                 copied.begin() + static_cast<std::ptrdiff_t>(start) +
+                     static_cast<std::ptrdiff_t>(overwritten));
+    for (std::size_t i = start; i < copied.size(); ++i) {
+      first_ns = std::min(first_ns, copied[i].second.begin_ns);
+    }
+  }
+
+  std::ofstream out{std::string(path)};
+  if (!out) {
+    return false;
+  }
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto &[thread, e] : copied) {
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    write_json_string(out, e.name);
+    // microseconds from first event
+    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+        << ",\"ts\":" << (e.begin_ns - first_ns) / 1000.0
+        << ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000.0 << '}';
+    first = false;
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
+
+} // namespace tme
@@ -0,0 +1,332 @@
+#include "raster.hxx"
+#include "profiler.hxx"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tme {
+
+// vertex positions are snapped to 1/16 of pixel
+static constexpr std::int64_t subpixel_bits = 4;
+static constexpr std::int64_t subpixel_one = 1 << subpixel_bits;
+static constexpr std::int64_t subpixel_half = subpixel_one / 2;
+// bigger triangles are split, so edge functions of every pixel in
+// bounding box fit in 32 bits
+static constexpr float max_span = 1024.f;
+static constexpr int max_split_depth = 32;
+
+static std::int64_t floor_div(std::int64_t v, std::int64_t d) {
+  return v >= 0 ? v / d : -((-v + d - 1) / d);
+}
+
+static std::uint32_t pack(float r, float g, float b, float a) {
+  auto to_byte = [](float f) {
+    return static_cast<std::uint32_t>(std::clamp(f, 0.f, 1.f) * 255.f + .5f);
+  };
+  return to_byte(r) | to_byte(g) << 8 | to_byte(b) << 16 | to_byte(a) << 24;
+}
+
+software_rasterizer::software_rasterizer(std::uint32_t width_,
+                                         std::uint32_t height_,
+                                         std::size_t threads)
+    : width(width_), height(height_),
+      tiles_x((width_ + tile_size - 1) / tile_size),
+      tiles_y((height_ + tile_size - 1) / tile_size),
+      pixels(std::size_t{width_} * height_, 0),
+      front(std::size_t{width_} * height_, 0), pool(threads) {
+  bins.resize(std::size_t{tiles_x} * tiles_y);
+}
+
+void software_rasterizer::draw(const v2 &a, const v2 &b, const v2 &c,
+                               const texture_gl_es20 *tex) {
+  const v2 *in[3] = {&a, &b, &c};
+  vertex out[3];
+  for (std::size_t i = 0; i < 3; ++i) {
+    out[i].x = (in[i]->pos.x + 1.f) * 0.5f * width;
+    out[i].y = (1.f - in[i]->pos.y) * 0.5f * height;
+    out[i].u = in[i]->uv.x;
+    out[i].v = in[i]->uv.y;
+    out[i].rgba[0] = in[i]->c.get_r();
+    out[i].rgba[1] = in[i]->c.get_g();
+    out[i].rgba[2] = in[i]->c.get_b();
+    out[i].rgba[3] = in[i]->c.get_a();
+  }
+  add(out[0], out[1], out[2], tex, 0);
+}
+
+void software_rasterizer::add(const vertex &v0, const vertex &v1,
+                              const vertex &v2, const texture_gl_es20 *tex,
+                              int depth) {
+  const float min_x = std::min({v0.x, v1.x, v2.x});
+  const float max_x = std::max({v0.x, v1.x, v2.x});
+  const float min_y = std::min({v0.y, v1.y, v2.y});
+  const float max_y = std::max({v0.y, v1.y, v2.y});
+  if (!std::isfinite(max_x - min_x) || !std::isfinite(max_y - min_y)) {
+    return;
+  }
+  if (max_x < 0.f || max_y < 0.f || min_x > width || min_y > height) {
+    return;
+  }
+  if (max_x - min_x <= max_span && max_y - min_y <= max_span) {
+    setup(v0, v1, v2, tex);
+    return;
+  }
+  if (depth == max_split_depth) {
+    return;
+  }
+
+  // split longest edge in the middle, attributes are linear so halves
+  // look exactly like whole triangle
+  const vertex *v[3] = {&v0, &v1, &v2};
+  std::size_t longest = 0;
+  float longest_length = -1.f;
+  for (std::size_t i = 0; i < 3; ++i) {
+    const vertex &p = *v[i];
+    const vertex &q = *v[(i + 1) % 3];
+    const float length = std::abs(q.x - p.x) + std::abs(q.y - p.y);
+    if (length > longest_length) {
+      longest = i;
+      longest_length = length;
+    }
+  }
+  const vertex &p = *v[longest];
+  const vertex &q = *v[(longest + 1) % 3];
+  const vertex &r = *v[(longest + 2) % 3];
+  vertex mid;
+  mid.x = (p.x + q.x) * 0.5f;
+  mid.y = (p.y + q.y) * 0.5f;
+  mid.u = (p.u + q.u) * 0.5f;
+  mid.v = (p.v + q.v) * 0.5f;
+  for (std::size_t i = 0; i < 4; ++i) {
+    mid.rgba[i] = (p.rgba[i] + q.rgba[i]) * 0.5f;
+  }
+  add(p, mid, r, tex, depth + 1);
+  add(mid, q, r, tex, depth + 1);
+}
+
+void software_rasterizer::setup(const vertex &v0, const vertex &v1,
+                                const vertex &v2,
+                                const texture_gl_es20 *tex) {
+  const vertex *v[3] = {&v0, &v1, &v2};
+  std::int64_t x[3];
+  std::int64_t y[3];
+  for (std::size_t i = 0; i < 3; ++i) {
+    x[i] = std::llround(v[i]->x * subpixel_one);
+    y[i] = std::llround(v[i]->y * subpixel_one);
+  }
+
+  const std::int64_t area =
+      (x[2] - x[1]) * (y[0] - y[1]) - (y[2] - y[1]) * (x[0] - x[1]);
+  if (area == 0) {
+    return;
+  }
+  const std::int64_t sign = area > 0 ? 1 : -1;
+
+  triangle t;
+  for (std::size_t i = 0; i < 3; ++i) {
+    const std::size_t j = (i + 1) % 3;
+    const std::size_t k = (i + 2) % 3;
+    const std::int64_t a = -(y[k] - y[j]) * sign;
+    const std::int64_t b = (x[k] - x[j]) * sign;
+    // top left fill rule: pixel centers exactly on other edges belong to
+    // neighbour triangle, so shared edges are drawn once
+    const bool top_left = a > 0 || (a == 0 && b > 0);
+    t.a[i] = static_cast<std::int32_t>(a);
+    t.b[i] = static_cast<std::int32_t>(b);
+    t.c[i] = -(a * x[j] + b * y[j]) - (top_left ? 0 : 1);
+  }
+  t.inv_area = 1.f / static_cast<float>(area * sign);
+
+  const float attr[3][6] = {
+      {v0.u, v0.v, v0.rgba[0], v0.rgba[1], v0.rgba[2], v0.rgba[3]},
+      {v1.u, v1.v, v1.rgba[0], v1.rgba[1], v1.rgba[2], v1.rgba[3]},
+      {v2.u, v2.v, v2.rgba[0], v2.rgba[1], v2.rgba[2], v2.rgba[3]}};
+  for (std::size_t i = 0; i < 6; ++i) {
+    t.attr0[i] = attr[0][i];
+    t.attr_d1[i] = attr[1][i] - attr[0][i];
+    t.attr_d2[i] = attr[2][i] - attr[0][i];
+  }
+
+  t.texels = nullptr;
+  t.tex_width = 0;
+  t.tex_height = 0;
+  if (tex != nullptr && !tex->get_pixels().empty()) {
+    t.texels = tex->get_pixels().data();
+    t.tex_width = static_cast<std::int32_t>(tex->get_width());
+    t.tex_height = static_cast<std::int32_t>(tex->get_height());
+  }
+
+  // pixels whose centers may be inside
+  const std::int64_t min_x = *std::min_element(x, x + 3);
+  const std::int64_t max_x = *std::max_element(x, x + 3);
+  const std::int64_t min_y = *std::min_element(y, y + 3);
+  const std::int64_t max_y = *std::max_element(y, y + 3);
+  const std::int64_t last_x = static_cast<std::int64_t>(width) - 1;
+  const std::int64_t last_y = static_cast<std::int64_t>(height) - 1;
+  t.min_x = static_cast<std::int32_t>(std::clamp<std::int64_t>(
+      -floor_div(subpixel_half - min_x, subpixel_one), 0, last_x + 1));
+  t.min_y = static_cast<std::int32_t>(std::clamp<std::int64_t>(
+      -floor_div(subpixel_half - min_y, subpixel_one), 0, last_y + 1));
+  t.max_x = static_cast<std::int32_t>(std::clamp<std::int64_t>(
+      floor_div(max_x - subpixel_half, subpixel_one), -1, last_x));
+  t.max_y = static_cast<std::int32_t>(std::clamp<std::int64_t>(
+      floor_div(max_y - subpixel_half, subpixel_one), -1, last_y));
+  if (t.min_x > t.max_x || t.min_y > t.max_y) {
+    return;
+  }
+  triangles.push_back(t);
+}
+
+void software_rasterizer::clear(std::uint32_t rgba) {
+  std::fill(pixels.begin(), pixels.end(), rgba);
+}
+
+void software_rasterizer::swap(std::uint32_t rgba) {
+  pixels.swap(front);
+  clear(rgba);
+}
+
+void software_rasterizer::finish_frame() {
+  TME_PROFILE_SCOPE("raster frame");
+  last_triangles = triangles.size();
+  if (triangles.empty()) {
+    return;
+  }
+  for (std::size_t i = 0; i < triangles.size(); ++i) {
+    const triangle &t = triangles[i];
+    for (std::uint32_t ty = static_cast<std::uint32_t>(t.min_y) / tile_size;
+         ty <= static_cast<std::uint32_t>(t.max_y) / tile_size; ++ty) {
+      for (std::uint32_t tx = static_cast<std::uint32_t>(t.min_x) / tile_size;
+           tx <= static_cast<std::uint32_t>(t.max_x) / tile_size; ++tx) {
+        bins[ty * tiles_x + tx].push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+  }
+
+  pool.parallel_for(bins.size(), [this](std::size_t tile) {
+    draw_tile(tile);
+  });
+
+  for (std::vector<std::uint32_t> &bin : bins) {
+    bin.clear();
+  }
+  triangles.clear();
+}
+
+void software_rasterizer::shade(const triangle &t, std::int32_t e1,
+                                std::int32_t e2, std::uint32_t &dst) {
+  const float l1 = static_cast<float>(e1) * t.inv_area;
+  const float l2 = static_cast<float>(e2) * t.inv_area;
+  float attr[6];
+  for (std::size_t i = 0; i < 6; ++i) {
+    attr[i] = t.attr0[i] + l1 * t.attr_d1[i] + l2 * t.attr_d2[i];
+  }
+
+  float texel[4] = {1.f, 1.f, 1.f, 1.f};
+  if (t.texels != nullptr) {
+    // nearest texel, coordinates repeat like GL_REPEAT
+    std::int32_t tx = static_cast<std::int32_t>(
+                          std::floor(attr[0] * t.tex_width)) %
+                      t.tex_width;
+    std::int32_t ty = static_cast<std::int32_t>(
+                          std::floor(attr[1] * t.tex_height)) %
+                      t.tex_height;
+    tx += tx < 0 ? t.tex_width : 0;
+    ty += ty < 0 ? t.tex_height : 0;
+    const unsigned char *src =
+        t.texels + 4 * (std::size_t(ty) * std::size_t(t.tex_width) + tx);
+    for (std::size_t i = 0; i < 4; ++i) {
+      texel[i] = src[i] * (1.f / 255.f);
+    }
+  }
+
+  const float alpha = texel[3] * attr[5];
+  float out[4];
+  for (std::size_t i = 0; i < 4; ++i) {
+    const float d = static_cast<float>((dst >> (8 * i)) & 0xFF) / 255.f;
+    out[i] = texel[i] * attr[2 + i] * alpha + d * (1.f - alpha);
+  }
+  dst = pack(out[0], out[1], out[2], out[3]);
+}
+
+void software_rasterizer::draw_tile(std::size_t tile) {
+  TME_PROFILE_SCOPE("raster tile");
+  const std::int32_t tile_x0 =
+      static_cast<std::int32_t>(tile % tiles_x * tile_size);
+  const std::int32_t tile_y0 =
+      static_cast<std::int32_t>(tile / tiles_x * tile_size);
+  const std::int32_t tile_x1 = static_cast<std::int32_t>(
+      std::min(static_cast<std::uint32_t>(tile_x0) + tile_size, width) - 1);
+  const std::int32_t tile_y1 = static_cast<std::int32_t>(
+      std::min(static_cast<std::uint32_t>(tile_y0) + tile_size, height) - 1);
+
+  for (std::uint32_t index : bins[tile]) {
+    const triangle &t = triangles[index];
+    const std::int32_t x0 = std::max(t.min_x, tile_x0);
+    const std::int32_t x1 = std::min(t.max_x, tile_x1);
+    const std::int32_t y0 = std::max(t.min_y, tile_y0);
+    const std::int32_t y1 = std::min(t.max_y, tile_y1);
+    if (x0 > x1 || y0 > y1) {
+      continue;
+    }
+
+    for (std::int32_t py = y0; py <= y1; ++py) {
+      std::uint32_t *row = pixels.data() + std::size_t{width} * py;
+      const std::int64_t sx = x0 * subpixel_one + subpixel_half;
+      const std::int64_t sy = py * subpixel_one + subpixel_half;
+      std::int32_t e[3];
+      for (std::size_t i = 0; i < 3; ++i) {
+        e[i] = static_cast<std::int32_t>(t.a[i] * sx + t.b[i] * sy + t.c[i]);
+      }
+#if defined(__SSE2__)
+      // edge functions of 4 neighbour pixels at once, pixel is inside
+      // when sign bits of all 3 edges are clear
+      __m128i e4[3];
+      __m128i step4[3];
+      for (std::size_t i = 0; i < 3; ++i) {
+        const std::int32_t step = t.a[i] * static_cast<std::int32_t>(
+                                               subpixel_one);
+        e4[i] = _mm_add_epi32(_mm_set1_epi32(e[i]),
+                              _mm_set_epi32(3 * step, 2 * step, step, 0));
+        step4[i] = _mm_set1_epi32(4 * step);
+      }
+      for (std::int32_t px = x0; px <= x1; px += 4) {
+        const __m128i outside =
+            _mm_or_si128(_mm_or_si128(e4[0], e4[1]), e4[2]);
+        int mask = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+        if (x1 - px < 3) {
+          mask &= (1 << (x1 - px + 1)) - 1;
+        }
+        if (mask != 0) {
+          alignas(16) std::int32_t e1[4];
+          alignas(16) std::int32_t e2[4];
+          _mm_store_si128(reinterpret_cast<__m128i *>(e1), e4[1]);
+          _mm_store_si128(reinterpret_cast<__m128i *>(e2), e4[2]);
+          for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+              shade(t, e1[lane], e2[lane], row[px + lane]);
+            }
+          }
+        }
+        for (std::size_t i = 0; i < 3; ++i) {
+          e4[i] = _mm_add_epi32(e4[i], step4[i]);
+        }
+      }
+#else
+      for (std::int32_t px = x0; px <= x1; ++px) {
+        if ((e[0] | e[1] | e[2]) >= 0) {
+          shade(t, e[1], e[2], row[px]);
+        }
+        for (std::size_t i = 0; i < 3; ++i) {
+          e[i] += t.a[i] * static_cast<std::int32_t>(subpixel_one);
+        }
+      }
+#endif
+    }
+  }
+}
+
+} // namespace tme
@@ -0,0 +1,86 @@
+#include "render_queue.hxx"
+#include "profiler.hxx"
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace tme {
+
+/// map float to unsigned int with same order, negative numbers included
+static std::uint32_t depth_bits(float depth) {
+  std::uint32_t bits = 0;
+  std::memcpy(&bits, &depth, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+void render_queue::push(const quad2 &q, texture_gl_es20 *tex,
+                        const mat3x2 &m, std::uint8_t layer, float depth) {
+  assert(tex != nullptr);
+  const std::uint64_t texture_id = tex->get_id();
+  assert(texture_id < (1u << 24));
+  const std::uint64_t key = static_cast<std::uint64_t>(layer) << 56 |
+                            texture_id << 32 | depth_bits(depth);
+
+  items.push_back(item{key, static_cast<std::uint32_t>(entries.size())});
+  entries.push_back(entry{q, m, tex});
+}
+
+void render_queue::sort() {
+  // least significant byte first, every pass is stable
+  sorted.resize(items.size());
+  for (unsigned shift = 0; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> offsets{};
+    for (const item &i : items) {
+      ++offsets[(i.key >> shift) & 0xff];
+    }
+    // all keys have same byte, pass changes nothing
+    if (offsets[(items.front().key >> shift) & 0xff] == items.size()) {
+      continue;
+    }
+    std::size_t sum = 0;
+    for (std::size_t &o : offsets) {
+      const std::size_t count = o;
+      o = sum;
+      sum += count;
+    }
+    for (const item &i : items) {
+      sorted[offsets[(i.key >> shift) & 0xff]++] = i;
+    }
+    items.swap(sorted);
+  }
+}
+
+void render_queue::flush(sprite_batch &batch) {
+  TME_PROFILE_SCOPE("render_queue flush");
+  last_submissions = static_cast<std::uint32_t>(items.size());
+  last_state_changes = 0;
+  last_sort_ms = 0.f;
+  if (items.empty()) {
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  sort();
+  const auto finish = std::chrono::steady_clock::now();
+  last_sort_ms =
+      std::chrono::duration<float, std::milli>(finish - start).count();
+
+  // texture bits
+  const std::uint64_t state_mask = 0x00ffffff00000000u;
+  std::uint64_t previous = items.front().key & state_mask;
+  last_state_changes = 1;
+  for (const item &i : items) {
+    if ((i.key & state_mask) != previous) {
+      previous = i.key & state_mask;
+      ++last_state_changes;
+    }
+    const entry &e = entries[i.entry];
+    batch.submit(e.q, e.tex, e.m);
+  }
+
+  entries.clear();
+  items.clear();
+}
+
+} // namespace tme
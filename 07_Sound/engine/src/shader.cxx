@@ -1,5 +1,7 @@
 #include "shader.hxx"
 #include "gl_init.hxx"
+#include "gl_state.hxx"
+#include "profiler.hxx"
 #include <exception>
 
 namespace tme {
@@ -16,61 +18,87 @@ shader_gl_es20::shader_gl_es20(
   if (program_id == 0) {
     throw std::runtime_error("can't link shader");
   }
+  read_active_uniforms();
 }
-void shader_gl_es20::use() const {
-  gl::glUseProgram(program_id);
-  GL_CHECK();
-}
+void shader_gl_es20::use() const { gl_state::use_program(program_id); }
 
-void shader_gl_es20::set_uniform(std::string_view uniform_name,
-                                 const mat3x2 m) const {
-  const int location =
-      gl::glGetUniformLocation(program_id, uniform_name.data());
-  GL_CHECK();
-  if (location == -1) {
-    std::cerr << "can't get uniform location from shader\n";
-    throw std::runtime_error("can't get uniform location");
+uniform_location shader_gl_es20::get_uniform(
+    std::string_view uniform_name) const {
+  for (const auto &u : uniforms) {
+    if (u.first == uniform_name) {
+      return uniform_location{u.second};
+    }
   }
-  std::vector<float> values = m.get_floats();
-  gl::glUniformMatrix3fv(location, 1, GL_FALSE, &values[0]);
+  std::cerr << "can't get uniform location from shader: " << uniform_name
+            << '\n';
+  throw std::runtime_error("can't get uniform location");
+}
+
+void shader_gl_es20::set_uniform(uniform_location u, const mat3x2 &m) const {
+  assert(u.value != -1);
+  const std::array<float, 9> values = m.get_column_major();
+  gl::glUniformMatrix3fv(u.value, 1, GL_FALSE, values.data());
   GL_CHECK();
 }
-void shader_gl_es20::set_uniform(std::string_view uniform_name,
-                                 texture_gl_es20 *texture) {
+void shader_gl_es20::set_uniform(uniform_location u,
+                                 texture_gl_es20 *texture) const {
+  assert(u.value != -1);
   assert(texture != nullptr);
-  GLint location = gl::glGetUniformLocation(program_id, uniform_name.data());
-  if (location == -1) {
-    std::cerr << uniform_name.data();
-    throw std::runtime_error("can't get uniform location");
-  }
 
   unsigned int texture_unit = 0;
-  gl::glActiveTextureMY(GL_TEXTURE0 + texture_unit);
+  texture->bind(texture_unit);
+
+  // http://www.khronos.org/opengles/sdk/docs/man/xhtml/glUniform.xml
+  gl::glUniform1i(u.value, static_cast<int>(0 + texture_unit));
   GL_CHECK();
+}
 
-  texture->bind();
+void shader_gl_es20::set_uniform(uniform_location u, const color &c) const {
+  assert(u.value != -1);
+  float values[4] = {c.get_r(), c.get_g(), c.get_b(), c.get_a()};
+  gl::glUniform4fv(u.value, 1, &values[0]);
+  GL_CHECK();
+}
 
-  // http://www.khronos.org/opengles/sdk/docs/man/xhtml/glUniform.xml
-  gl::glUniform1i(location, static_cast<int>(0 + texture_unit));
+void shader_gl_es20::set_uniform(uniform_location u,
+                                 const std::array<float, 4> &v) const {
+  assert(u.value != -1);
+  gl::glUniform4fv(u.value, 1, v.data());
   GL_CHECK();
 }
 
-void shader_gl_es20::set_uniform(std::string_view uniform_name,
-                                 const color &c) {
-  const int location =
-      gl::glGetUniformLocation(program_id, uniform_name.data());
+void shader_gl_es20::read_active_uniforms() {
+  GLint count = 0;
+  gl::glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &count);
   GL_CHECK();
-  if (location == -1) {
-    std::cerr << "can't get uniform location from shader\n";
-    throw std::runtime_error("can't get uniform location");
-  }
-  float values[4] = {c.get_r(), c.get_g(), c.get_b(), c.get_a()};
-  gl::glUniform4fv(location, 1, &values[0]);
+  GLint max_length = 0;
+  gl::glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
   GL_CHECK();
+
+  std::vector<GLchar> name(static_cast<size_t>(max_length) + 1);
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    gl::glGetActiveUniform(program_id, static_cast<GLuint>(i),
+                           static_cast<GLsizei>(name.size()), &length, &size,
+                           &type, name.data());
+    GL_CHECK();
+    std::string uniform_name(name.data(), static_cast<size_t>(length));
+    // arrays are reported as "name[0]"
+    const size_t bracket = uniform_name.find('[');
+    if (bracket != std::string::npos) {
+      uniform_name.resize(bracket);
+    }
+    const GLint location = gl::glGetUniformLocation(program_id, name.data());
+    GL_CHECK();
+    uniforms.emplace_back(std::move(uniform_name), location);
+  }
 }
 
 GLuint shader_gl_es20::compile_shader(GLenum shader_type,
                                       std::string_view src) {
+  TME_PROFILE_SCOPE("compile shader");
   GLuint shader_id = gl::glCreateShader(shader_type);
   GL_CHECK();
   std::string_view vertex_shader_src = src;
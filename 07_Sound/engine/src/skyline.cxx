@@ -0,0 +1,104 @@
+#include "skyline.hxx"
+#include <algorithm>
+#include <limits>
+
+namespace tme {
+
+skyline_packer::skyline_packer(std::uint32_t width_, std::uint32_t height_)
+    : width(width_), height(height_) {
+  skyline.push_back(segment{0, 0, width});
+}
+
+bool skyline_packer::fit(std::size_t i, std::uint32_t w, std::uint32_t h,
+                         std::uint32_t &y) const {
+  const std::uint32_t x = skyline[i].x;
+  if (x + w > width) {
+    return false;
+  }
+  y = skyline[i].y;
+  std::uint32_t width_left = w;
+  for (; width_left > 0; ++i) {
+    y = std::max(y, skyline[i].y);
+    if (y + h > height) {
+      return false;
+    }
+    width_left -= std::min(width_left, skyline[i].width);
+  }
+  return true;
+}
+
+bool skyline_packer::insert(std::uint32_t w, std::uint32_t h,
+                            std::uint32_t &x, std::uint32_t &y) {
+  if (w == 0 || h == 0) {
+    return false;
+  }
+  std::size_t best = skyline.size();
+  std::uint32_t best_top = std::numeric_limits<std::uint32_t>::max();
+  std::uint32_t best_width = std::numeric_limits<std::uint32_t>::max();
+
+  for (std::size_t i = 0; i < skyline.size(); ++i) {
+    std::uint32_t top = 0;
+    if (!fit(i, w, h, top)) {
+      continue;
+    }
+    // lowest top first, narrower segment on tie leaves wider ones free
+    if (top + h < best_top ||
+        (top + h == best_top && skyline[i].width < best_width)) {
+      best = i;
+      best_top = top + h;
+      best_width = skyline[i].width;
+    }
+  }
+  if (best == skyline.size()) {
+    return false;
+  }
+
+  x = skyline[best].x;
+  y = best_top - h;
+  add_level(best, x, y, w, h);
+  used_area += static_cast<std::uint64_t>(w) * h;
+  return true;
+}
+
+void skyline_packer::add_level(std::size_t i, std::uint32_t x,
+                               std::uint32_t y, std::uint32_t w,
+                               std::uint32_t h) {
+  // space between rectangle bottom and lower segments under it is lost
+  const std::uint32_t right = x + w;
+  for (std::size_t k = i; k < skyline.size() && skyline[k].x < right; ++k) {
+    const std::uint32_t covered =
+        std::min(right, skyline[k].x + skyline[k].width) - skyline[k].x;
+    wasted_area += static_cast<std::uint64_t>(covered) * (y - skyline[k].y);
+  }
+
+  skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(i),
+                 segment{x, y + h, w});
+
+  // cut or remove segments now hidden under new one
+  for (std::size_t k = i + 1; k < skyline.size();) {
+    segment &s = skyline[k];
+    if (s.x >= right) {
+      break;
+    }
+    const std::uint32_t s_right = s.x + s.width;
+    if (s_right <= right) {
+      skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(k));
+      continue;
+    }
+    s.width = s_right - right;
+    s.x = right;
+    break;
+  }
+
+  // join neighbours with same height
+  for (std::size_t k = 0; k + 1 < skyline.size();) {
+    if (skyline[k].y == skyline[k + 1].y) {
+      skyline[k].width += skyline[k + 1].width;
+      skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(k + 1));
+    } else {
+      ++k;
+    }
+  }
+}
+
+} // namespace tme
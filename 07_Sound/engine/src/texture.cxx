@@ -1,48 +1,319 @@
 #include "texture.hxx"
 #include "gl_init.hxx"
+#include "gl_state.hxx"
 #include "lodepng.h"
+#include "mipmap.hxx"
+#include "profiler.hxx"
+#include "texture_cache.hxx"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 namespace tme {
 
-texture_gl_es20::texture_gl_es20(std::string_view path) : file_path(path) {
+// lodepng scratch memory: blocks of power of two size with size class in
+// header; freed blocks wait in lists of their thread for next decode
+static constexpr std::size_t scratch_header = 16;
+static constexpr std::size_t scratch_classes = 48;
+// more freed memory than this goes back to heap
+static constexpr std::size_t scratch_keep = 64 * 1024 * 1024;
 
-  std::vector<unsigned char> image;
+struct png_scratch {
+  std::array<std::vector<void *>, scratch_classes> blocks;
+  std::size_t kept = 0;
+
+  ~png_scratch() {
+    for (auto &list : blocks) {
+      for (void *block : list) {
+        std::free(block);
+      }
+    }
+  }
+};
+
+static thread_local png_scratch scratch;
+
+static void *scratch_malloc(void *, std::size_t size) {
+  std::size_t size_class = 6;
+  while (size_class < scratch_classes &&
+         (std::size_t{1} << size_class) < size + scratch_header) {
+    ++size_class;
+  }
+  if (size_class == scratch_classes) {
+    return nullptr;
+  }
+  std::vector<void *> &list = scratch.blocks[size_class];
+  void *block = nullptr;
+  if (!list.empty()) {
+    block = list.back();
+    list.pop_back();
+    scratch.kept -= std::size_t{1} << size_class;
+  } else {
+    block = std::malloc(std::size_t{1} << size_class);
+    if (block == nullptr) {
+      return nullptr;
+    }
+  }
+  *static_cast<std::size_t *>(block) = size_class;
+  return static_cast<unsigned char *>(block) + scratch_header;
+}
+
+static void scratch_free(void *, void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  void *block = static_cast<unsigned char *>(ptr) - scratch_header;
+  const std::size_t size_class = *static_cast<std::size_t *>(block);
+  const std::size_t size = std::size_t{1} << size_class;
+  if (scratch.kept + size > scratch_keep) {
+    std::free(block);
+    return;
+  }
+  scratch.blocks[size_class].push_back(block);
+  scratch.kept += size;
+}
+
+static void *scratch_realloc(void *context, void *ptr, std::size_t size) {
+  if (ptr == nullptr) {
+    return scratch_malloc(context, size);
+  }
+  const void *block = static_cast<unsigned char *>(ptr) - scratch_header;
+  const std::size_t capacity =
+      (std::size_t{1} << *static_cast<const std::size_t *>(block)) -
+      scratch_header;
+  if (size <= capacity) {
+    return ptr;
+  }
+  void *result = scratch_malloc(context, size);
+  if (result != nullptr) {
+    std::memcpy(result, ptr, capacity);
+    scratch_free(context, ptr);
+  }
+  return result;
+}
+
+/// lodepng calls on this thread use scratch memory while alive
+struct scratch_scope {
+  scratch_scope() {
+    const LodePNGAllocator allocator = {scratch_malloc, scratch_realloc,
+                                        scratch_free, nullptr};
+    lodepng_set_thread_allocator(&allocator);
+  }
+  ~scratch_scope() { lodepng_set_thread_allocator(nullptr); }
+  scratch_scope(const scratch_scope &) = delete;
+  scratch_scope &operator=(const scratch_scope &) = delete;
+};
+
+static void png_error(unsigned error) {
+  // if there's an error, display it
+  std::cerr << "error: " << error << std::endl;
+  throw std::runtime_error("can't load texture");
+}
+
+png_file open_png(std::string_view path) {
+  png_file result;
+  if (!result.bytes.open(std::string(path))) {
+    png_error(78); // lodepng code for file that can't be read
+  }
   unsigned w = 0;
   unsigned h = 0;
-  int error = lodepng::decode(image, w, h, file_path);
+  unsigned error = 0;
+  {
+    scratch_scope scope;
+    lodepng::State state;
+    error = lodepng_inspect(&w, &h, &state, result.bytes.data(),
+                            result.bytes.size());
+  }
+  if (error != 0) {
+    png_error(error);
+  }
+  result.width = w;
+  result.height = h;
+  return result;
+}
 
-  // if there's an error, display it
+void decode_png(const png_file &file, unsigned char *rgba) {
+  TME_PROFILE_SCOPE("decode png");
+  unsigned w = 0;
+  unsigned h = 0;
+  unsigned error = 0;
+  {
+    // state lives inside scope, everything lodepng allocates goes back
+    // to scratch before allocator is reset
+    scratch_scope scope;
+    lodepng::State state;
+    error = lodepng_decode_into(rgba, std::size_t{4} * file.width * file.height,
+                                &w, &h, &state, file.bytes.data(),
+                                file.bytes.size());
+  }
   if (error != 0) {
-    std::cerr << "error: " << error << std::endl;
-    throw std::runtime_error("can't load texture");
+    png_error(error);
   }
-  //генерирует нужное количество имён для текстур
-  glGenTextures(1, &tex_handl);
-  GL_CHECK();
-  glBindTexture(GL_TEXTURE_2D, tex_handl);
-  GL_CHECK();
+}
+
+std::vector<unsigned char> load_png(std::string_view path,
+                                    std::uint32_t &width,
+                                    std::uint32_t &height) {
+  const png_file file = open_png(path);
+  std::vector<unsigned char> image(std::size_t{4} * file.width * file.height);
+  decode_png(file, image.data());
+  width = file.width;
+  height = file.height;
+  return image;
+}
+
+bool texture_gl_es20::keep_pixels = false;
+
+// ids of textures, gl thread only; next_id is count of ids ever given
+static std::uint32_t next_id = 0;
+static std::vector<std::uint32_t> free_ids;
+
+texture_gl_es20::texture_gl_es20(std::string_view path,
+                                 const texture_options &options_)
+    : file_path(path), options(options_) {
+  const rgba_image image = texture_cache::load(file_path, options.mipmaps);
+  width = image.width;
+  height = image.height;
+  create(image.data(), image.levels);
+}
+
+texture_gl_es20::texture_gl_es20(std::uint32_t width_, std::uint32_t height_)
+    : width(width_), height(height_) {
+  create(nullptr, 1);
+}
+
+texture_gl_es20::texture_gl_es20(const texture_gl_es20 &page_, std::uint32_t x,
+                                 std::uint32_t y, std::uint32_t w,
+                                 std::uint32_t h)
+    : file_path(page_.file_path), tex_handl(page_.tex_handl), width(w),
+      height(h), owns_handle(false), page(&page_) {
+  assert(x + w <= page_.width && y + h <= page_.height);
+  const float page_w = static_cast<float>(page_.width);
+  const float page_h = static_cast<float>(page_.height);
+  uv_rect = {{x / page_w, y / page_h, w / page_w, h / page_h}};
+}
+
+texture_gl_es20 *
+texture_gl_es20::create_loading(std::string_view path,
+                                const texture_options &options) {
+  const unsigned char transparent[4] = {0, 0, 0, 0};
+  texture_gl_es20 *result = new texture_gl_es20(1, 1);
+  result->update(0, 0, 1, 1, transparent);
+  // 1x1 is complete mip chain already
+  result->options = options;
+  result->apply_filters();
+  result->file_path = path;
+  result->status = texture_status::loading;
+  return result;
+}
+
+void texture_gl_es20::finish_loading(std::uint32_t w, std::uint32_t h,
+                                     std::uint32_t levels,
+                                     const unsigned char *rgba) {
+  TME_PROFILE_SCOPE("upload texture");
+  assert(owns_handle && status == texture_status::loading);
+  assert(rgba != nullptr || !keep_pixels);
+  width = w;
+  height = h;
+  if (keep_pixels) {
+    pixels.assign(rgba, rgba + std::size_t{4} * width * height);
+  }
+  gl_state::bind_texture(0, tex_handl);
+  upload_levels(rgba, levels);
+  status = texture_status::ready;
+}
 
-  GLint mipmap_level = 0;
+void texture_gl_es20::upload_levels(const unsigned char *rgba,
+                                    std::uint32_t levels) {
+  // mipmapped texture sampled without all its levels is incomplete
+  assert(!options.mipmaps || levels == mip_levels(width, height));
+  assert(rgba != nullptr || levels == 1);
   GLint border = 0;
-  GLsizei width = static_cast<GLsizei>(w);
-  GLsizei height = static_cast<GLsizei>(h);
-  glTexImage2D(GL_TEXTURE_2D, mipmap_level, GL_RGBA, width, height, border,
-               GL_RGBA, GL_UNSIGNED_BYTE, &image[0]);
-  GL_CHECK();
+  std::size_t offset = 0;
+  for (std::uint32_t level = 0; level < levels; ++level) {
+    const std::uint32_t w = mip_size(width, level);
+    const std::uint32_t h = mip_size(height, level);
+    gl::glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA,
+                     static_cast<GLsizei>(w), static_cast<GLsizei>(h), border,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba + offset);
+    GL_CHECK();
+    offset += std::size_t{4} * w * h;
+  }
+}
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+void texture_gl_es20::apply_filters() const {
+  const bool linear_min = options.min_filter == texture_filter::linear;
+  GLint min_filter = linear_min ? GL_LINEAR : GL_NEAREST;
+  if (options.mipmaps) {
+    min_filter = linear_min ? GL_LINEAR_MIPMAP_LINEAR
+                            : GL_NEAREST_MIPMAP_NEAREST;
+  }
+  const GLint mag_filter =
+      options.mag_filter == texture_filter::linear ? GL_LINEAR : GL_NEAREST;
+  gl_state::bind_texture(0, tex_handl);
+  gl::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
   GL_CHECK();
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  gl::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+  GL_CHECK();
+}
+
+void texture_gl_es20::create(const unsigned char *rgba,
+                             std::uint32_t levels) {
+  if (keep_pixels) {
+    const std::size_t size = std::size_t{4} * width * height;
+    if (rgba != nullptr) {
+      pixels.assign(rgba, rgba + size);
+    } else {
+      pixels.assign(size, 0);
+    }
+  }
+  if (free_ids.empty()) {
+    id = next_id++;
+  } else {
+    id = free_ids.back();
+    free_ids.pop_back();
+  }
+  //генерирует нужное количество имён для текстур
+  gl::glGenTextures(1, &tex_handl);
   GL_CHECK();
+  gl_state::bind_texture(0, tex_handl);
+
+  upload_levels(rgba, levels);
+  apply_filters();
+}
+
+void texture_gl_es20::bind(std::uint32_t unit) const {
+  gl_state::bind_texture(unit, tex_handl);
 }
 
-void texture_gl_es20::bind() const {
-  glBindTexture(GL_TEXTURE_2D, tex_handl);
+void texture_gl_es20::update(std::uint32_t x, std::uint32_t y,
+                             std::uint32_t w, std::uint32_t h,
+                             const unsigned char *rgba) {
+  assert(owns_handle);
+  assert(x + w <= width && y + h <= height);
+  gl_state::bind_texture(0, tex_handl);
+  gl::glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x),
+                      static_cast<GLint>(y), static_cast<GLsizei>(w),
+                      static_cast<GLsizei>(h), GL_RGBA, GL_UNSIGNED_BYTE,
+                      rgba);
   GL_CHECK();
+
+  if (!pixels.empty()) {
+    for (std::uint32_t row = 0; row < h; ++row) {
+      const unsigned char *src = rgba + std::size_t{4} * w * row;
+      std::copy(src, src + std::size_t{4} * w,
+                pixels.begin() + 4 * (std::size_t{width} * (y + row) + x));
+    }
+  }
 }
 
 texture_gl_es20::~texture_gl_es20() {
-  glDeleteTextures(1, &tex_handl);
+  if (!owns_handle) {
+    return;
+  }
+  free_ids.push_back(id);
+  gl_state::forget_texture(tex_handl);
+  gl::glDeleteTextures(1, &tex_handl);
   GL_CHECK();
 }
 } // namespace tme
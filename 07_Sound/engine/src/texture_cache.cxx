@@ -0,0 +1,287 @@
+#include "texture_cache.hxx"
+#include "profiler.hxx"
+#include "texture.hxx"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tme {
+
+mapped_file::~mapped_file() { close(); }
+
+mapped_file::mapped_file(mapped_file &&other) noexcept {
+  *this = std::move(other);
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+  if (this != &other) {
+    close();
+    std::swap(bytes, other.bytes);
+    std::swap(length, other.length);
+#ifdef _WIN32
+    std::swap(file, other.file);
+    std::swap(mapping, other.mapping);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+bool mapped_file::open(const std::string &path) {
+  close();
+  HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (f == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file = f;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(f, &file_size) || file_size.QuadPart == 0) {
+    close();
+    return false;
+  }
+  mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    close();
+    return false;
+  }
+  bytes = static_cast<const unsigned char *>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (bytes == nullptr) {
+    close();
+    return false;
+  }
+  length = static_cast<std::size_t>(file_size.QuadPart);
+  return true;
+}
+
+void mapped_file::close() {
+  if (bytes != nullptr) {
+    UnmapViewOfFile(bytes);
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+  }
+  if (file != nullptr) {
+    CloseHandle(file);
+  }
+  bytes = nullptr;
+  length = 0;
+  mapping = nullptr;
+  file = nullptr;
+}
+#else
+bool mapped_file::open(const std::string &path) {
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void *address = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                       PROT_READ, MAP_PRIVATE, fd, 0);
+  // mapping keeps file alive
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  bytes = static_cast<const unsigned char *>(address);
+  length = static_cast<std::size_t>(info.st_size);
+  return true;
+}
+
+void mapped_file::close() {
+  if (bytes != nullptr) {
+    munmap(const_cast<unsigned char *>(bytes), length);
+  }
+  bytes = nullptr;
+  length = 0;
+}
+#endif
+
+std::string texture_cache::directory;
+std::atomic<std::uint32_t> texture_cache::hits{0};
+std::atomic<std::uint32_t> texture_cache::misses{0};
+
+void texture_cache::set_directory(std::string_view dir) { directory = dir; }
+
+static constexpr char cooked_magic[8] = {'T', 'M', 'E', 'R',
+                                         'G', 'B', 'A', '2'};
+
+/// cooked file: header, source path, zero padding up to 16 bytes
+/// alignment, rgba pixels of levels of mip chain; numbers in host byte
+/// order, cache is not meant to be copied between machines
+struct cooked_header {
+  char magic[8];
+  std::uint64_t source_size;
+  std::int64_t source_mtime;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t path_length;
+  std::uint32_t levels;
+};
+
+static std::size_t pixels_offset(std::size_t path_length) {
+  return (sizeof(cooked_header) + path_length + 15) / 16 * 16;
+}
+
+/// 64 bit FNV-1a, names cache file after source path
+static std::uint64_t hash_path(std::string_view path) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (const char c : path) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static std::string cooked_path(const std::string &directory,
+                               std::string_view key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.rgba",
+                static_cast<unsigned long long>(hash_path(key)));
+  return (std::filesystem::path(directory) / name).string();
+}
+
+/// entry with mip chain also serves requests without one
+static bool read_cooked(const std::string &file, std::string_view key,
+                        const cooked_header &expected, bool mipmaps,
+                        rgba_image &image) {
+  mapped_file mapping;
+  if (!mapping.open(file) || mapping.size() < sizeof(cooked_header)) {
+    return false;
+  }
+  cooked_header header;
+  std::memcpy(&header, mapping.data(), sizeof(header));
+  if (std::memcmp(header.magic, cooked_magic, sizeof(cooked_magic)) != 0 ||
+      header.source_size != expected.source_size ||
+      header.source_mtime != expected.source_mtime ||
+      header.path_length != key.size()) {
+    return false;
+  }
+  if (header.levels == 0 ||
+      (mipmaps && header.levels != mip_levels(header.width, header.height))) {
+    return false;
+  }
+  const std::size_t offset = pixels_offset(key.size());
+  const std::size_t size =
+      mip_chain_size(header.width, header.height, header.levels);
+  // other source with same path hash, or file cut short by crash
+  if (mapping.size() != offset + size ||
+      std::memcmp(mapping.data() + sizeof(header), key.data(), key.size()) !=
+          0) {
+    return false;
+  }
+  image.width = header.width;
+  image.height = header.height;
+  image.levels = mipmaps ? header.levels : 1;
+  image.cooked = std::move(mapping);
+  image.cooked_offset = offset;
+  return true;
+}
+
+static void write_cooked(const std::string &file, std::string_view key,
+                         cooked_header header, const rgba_image &image) {
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(file).parent_path(), error);
+  std::memcpy(header.magic, cooked_magic, sizeof(cooked_magic));
+  header.width = image.width;
+  header.height = image.height;
+  header.path_length = static_cast<std::uint32_t>(key.size());
+  header.levels = image.levels;
+
+  // loader threads may cook same file at once, each writes own temporary
+  // file and rename replaces entry in one step
+  static std::atomic<std::uint32_t> temporary_id{0};
+  const std::string temporary =
+      file + '.' + std::to_string(temporary_id++) + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary);
+    const char padding[16] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(key.data(), static_cast<std::streamsize>(key.size()));
+    out.write(padding, static_cast<std::streamsize>(
+                           pixels_offset(key.size()) - sizeof(header) -
+                           key.size()));
+    out.write(reinterpret_cast<const char *>(image.data()),
+              static_cast<std::streamsize>(image.size()));
+    if (!out) {
+      out.close();
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, file, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+  }
+}
+
+static void decode(std::string_view path, bool mipmaps,
+                   std::vector<unsigned char> storage, rgba_image &image) {
+  const png_file file = open_png(path);
+  image.width = file.width;
+  image.height = file.height;
+  image.levels = mipmaps ? mip_levels(file.width, file.height) : 1;
+  storage.resize(image.size());
+  decode_png(file, storage.data());
+  generate_mips(storage.data(), image.width, image.height, image.levels);
+  image.decoded = std::move(storage);
+}
+
+rgba_image texture_cache::load(std::string_view path, bool mipmaps,
+                               std::vector<unsigned char> storage) {
+  rgba_image image;
+  if (directory.empty()) {
+    decode(path, mipmaps, std::move(storage), image);
+    return image;
+  }
+
+  const std::filesystem::path source(path);
+  std::error_code error;
+  cooked_header key{};
+  key.source_size = std::filesystem::file_size(source, error);
+  if (!error) {
+    key.source_mtime = static_cast<std::int64_t>(
+        std::filesystem::last_write_time(source, error)
+            .time_since_epoch()
+            .count());
+  }
+  if (error) {
+    // missing source, let open_png report it
+    decode(path, mipmaps, std::move(storage), image);
+    return image;
+  }
+
+  const std::string file = cooked_path(directory, path);
+  {
+    TME_PROFILE_SCOPE("map cooked texture");
+    if (read_cooked(file, path, key, mipmaps, image)) {
+      ++hits;
+      return image;
+    }
+  }
+  ++misses;
+  decode(path, mipmaps, std::move(storage), image);
+  TME_PROFILE_SCOPE("write cooked texture");
+  write_cooked(file, path, key, image);
+  return image;
+}
+
+} // namespace tme
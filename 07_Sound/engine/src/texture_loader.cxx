@@ -0,0 +1,245 @@
+#include "texture_loader.hxx"
+#include "gl_init.hxx"
+#include "profiler.hxx"
+#include <algorithm>
+
+namespace tme {
+
+unpack_buffer_pool::~unpack_buffer_pool() {
+  if (!names.empty()) {
+    // mapped buffers are unmapped by delete
+    gl::glDeleteBuffers(static_cast<GLsizei>(names.size()), names.data());
+    GL_CHECK();
+  }
+}
+
+unpack_buffer_pool::buffer unpack_buffer_pool::acquire(std::size_t size) {
+  buffer result;
+  if (!free_buffers.empty()) {
+    // smallest buffer that fits, or largest to grow
+    auto best = free_buffers.begin();
+    for (auto it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+      const bool fits = it->capacity >= size;
+      const bool best_fits = best->capacity >= size;
+      if (fits ? !best_fits || it->capacity < best->capacity
+               : !best_fits && it->capacity > best->capacity) {
+        best = it;
+      }
+    }
+    result = *best;
+    free_buffers.erase(best);
+  } else {
+    gl::glGenBuffers(1, &result.name);
+    GL_CHECK();
+    names.push_back(result.name);
+  }
+  result.capacity = std::max(result.capacity, size);
+
+  gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, result.name);
+  GL_CHECK();
+  // new storage every time, so upload from previous contents may still
+  // read old one without stalling
+  gl::glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                   static_cast<GLsizeiptr>(result.capacity), nullptr,
+                   GL_STREAM_DRAW);
+  GL_CHECK();
+  result.mapped = static_cast<unsigned char *>(
+      gl::glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
+  GL_CHECK();
+  gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  GL_CHECK();
+  return result;
+}
+
+void unpack_buffer_pool::release(const buffer &b) {
+  assert(b.mapped == nullptr);
+  free_buffers.push_back(b);
+}
+
+texture_loader::texture_loader(std::size_t threads)
+    : use_unpack_buffers(gl::has_pixel_buffer_objects &&
+                         !texture_gl_es20::keep_pixels &&
+                         !texture_cache::is_enabled()),
+      pool(threads) {}
+
+texture_loader::~texture_loader() {
+  for (auto &entry : jobs) {
+    entry.second->cancelled = true;
+  }
+}
+
+texture_gl_es20 *texture_loader::load(std::string_view path,
+                                      const texture_options &options) {
+  texture_gl_es20 *result = texture_gl_es20::create_loading(path, options);
+  auto j = std::make_shared<job>();
+  j->path = path;
+  j->mipmaps = options.mipmaps;
+  j->target = result;
+  j->unpack = use_unpack_buffers && !options.mipmaps;
+  jobs.emplace(result, j);
+  submit(j);
+  return result;
+}
+
+void texture_loader::forget(texture_gl_es20 *t) {
+  const auto it = jobs.find(t);
+  if (it != jobs.end()) {
+    // worker skips decode, upload skips result
+    it->second->cancelled = true;
+    jobs.erase(it);
+  }
+}
+
+void texture_loader::submit(const std::shared_ptr<job> &j) {
+  ++decoding;
+  pool.submit([this, j] { decode(j); });
+}
+
+std::vector<unsigned char> texture_loader::take_spare() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (spare.empty()) {
+    return {};
+  }
+  std::vector<unsigned char> result = std::move(spare.back());
+  spare.pop_back();
+  return result;
+}
+
+void texture_loader::decode(const std::shared_ptr<job> &j) {
+  if (j->cancelled) {
+    // mapped buffer still has to go back to pool on gl thread
+    if (j->buffer.name == 0) {
+      --decoding;
+      return;
+    }
+  } else {
+    try {
+      if (!j->unpack) {
+        j->image = texture_cache::load(j->path, j->mipmaps, take_spare());
+      } else if (j->buffer.name == 0) {
+        j->file = open_png(j->path);
+      } else {
+        decode_png(j->file, j->buffer.mapped);
+      }
+    } catch (std::exception &) {
+      // open_png or decode_png already reported error
+      j->failed = true;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  decoded.push_back(j);
+  --decoding;
+}
+
+void texture_loader::release_buffer(job &j) {
+  if (j.buffer.name == 0) {
+    return;
+  }
+  if (j.buffer.mapped != nullptr) {
+    gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, j.buffer.name);
+    GL_CHECK();
+    gl::glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    GL_CHECK();
+    gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GL_CHECK();
+    j.buffer.mapped = nullptr;
+  }
+  mapped_bytes -= std::size_t{4} * j.file.width * j.file.height;
+  buffers.release(j.buffer);
+  j.buffer = unpack_buffer_pool::buffer();
+}
+
+void texture_loader::upload(std::size_t budget) {
+  std::vector<std::shared_ptr<job>> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (decoded.empty()) {
+      return;
+    }
+    ready.swap(decoded);
+  }
+  TME_PROFILE_SCOPE("upload textures");
+
+  std::vector<std::shared_ptr<job>> later;
+  std::size_t used = 0;
+  // buffers are mapped in order of loading, smaller image must not take
+  // one ahead of image still waiting
+  bool buffers_full = false;
+  for (std::shared_ptr<job> &entry : ready) {
+    job &j = *entry;
+    if (j.cancelled) {
+      release_buffer(j);
+      continue;
+    }
+    const std::size_t size = std::size_t{4} * j.file.width * j.file.height;
+    if (!j.failed && j.unpack && j.buffer.name == 0) {
+      // size is known, decode waits for buffer
+      buffers_full = buffers_full ||
+                     (mapped_bytes != 0 && mapped_bytes + size > 4 * budget);
+      if (buffers_full) {
+        later.push_back(std::move(entry));
+        continue;
+      }
+      j.buffer = buffers.acquire(size);
+      mapped_bytes += size;
+      if (j.buffer.mapped == nullptr) {
+        // decode into memory instead
+        release_buffer(j);
+        j.unpack = false;
+      }
+      submit(entry);
+      continue;
+    }
+    if (used >= budget && used != 0) {
+      // rest waits for next frame, ahead of images decoded meanwhile
+      later.push_back(std::move(entry));
+      continue;
+    }
+
+    if (j.failed) {
+      release_buffer(j);
+      j.target->fail_loading();
+    } else if (j.unpack) {
+      gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, j.buffer.name);
+      GL_CHECK();
+      // false if buffer contents were lost, e.g. on display mode change
+      const bool intact = gl::glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+      GL_CHECK();
+      j.buffer.mapped = nullptr;
+      if (intact) {
+        j.target->finish_loading(j.file.width, j.file.height, 1, nullptr);
+      }
+      gl::glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      GL_CHECK();
+      release_buffer(j);
+      if (!intact) {
+        // map new buffer and decode again
+        later.push_back(std::move(entry));
+        continue;
+      }
+      used += size;
+    } else {
+      j.target->finish_loading(j.image.width, j.image.height, j.image.levels,
+                               j.image.data());
+      used += j.image.size();
+      if (j.image.decoded.capacity() != 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // one spare per worker is enough to not allocate again
+        if (spare.size() < pool.get_thread_count()) {
+          spare.push_back(std::move(j.image.decoded));
+        }
+      }
+    }
+    jobs.erase(j.target);
+    // source file, decoded pixels or cache mapping are not needed after
+    // upload
+    entry.reset();
+  }
+
+  if (!later.empty()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.insert(decoded.begin(), later.begin(), later.end());
+  }
+}
+
+} // namespace tme
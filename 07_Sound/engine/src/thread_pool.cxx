@@ -0,0 +1,81 @@
+#include "thread_pool.hxx"
+#include <algorithm>
+#include <atomic>
+
+namespace tme {
+
+thread_pool::thread_pool(std::size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([this] { work(); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (std::thread &t : workers) {
+    t.join();
+  }
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  wake.notify_one();
+}
+
+void thread_pool::work() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stop || !tasks.empty(); });
+      if (stop && tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void thread_pool::parallel_for(std::size_t count,
+                               const std::function<void(std::size_t)> &f) {
+  std::atomic<std::size_t> next{0};
+  std::size_t finished = 0;
+  std::mutex done_mutex;
+  std::condition_variable done;
+
+  // every helper takes indexes until none left, so slow items don't
+  // leave other threads idle
+  auto run = [&] {
+    for (std::size_t i = next++; i < count; i = next++) {
+      f(i);
+    }
+  };
+  const std::size_t helpers = std::min(workers.size(), count);
+  for (std::size_t h = 0; h < helpers; ++h) {
+    submit([&] {
+      run();
+      std::lock_guard<std::mutex> lock(done_mutex);
+      ++finished;
+      done.notify_one();
+    });
+  }
+  run();
+
+  std::unique_lock<std::mutex> lock(done_mutex);
+  done.wait(lock, [&] { return finished == helpers; });
+}
+
+} // namespace tme
@@ -0,0 +1,170 @@
+#include "engine.hxx"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TME_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace tme {
+
+// every kernel transforms count positions of contiguous array
+using transform_kernel = void (*)(const vec2 *in, vec2 *out,
+                                  std::size_t count, const mat3x2 &m);
+
+static void transform_scalar(const vec2 *in, vec2 *out, std::size_t count,
+                             const mat3x2 &m) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = in[i] * m;
+  }
+}
+
+// every vertex kernel transforms positions of count vertices and copies
+// their uv and color in same pass
+using vertex_kernel = void (*)(const v2 *in, v2 *out, std::size_t count,
+                               const mat3x2 &m);
+
+static void transform_vertices_scalar(const v2 *in, v2 *out,
+                                      std::size_t count, const mat3x2 &m) {
+  for (std::size_t i = 0; i < count; ++i) {
+    v2 v = in[i];
+    v.pos = v.pos * m;
+    out[i] = v;
+  }
+}
+
+#ifdef TME_X86_SIMD
+
+// (x0, y0, x1, y1) * m for two positions at once
+__attribute__((target("sse2"))) static void
+transform_sse2(const vec2 *in, vec2 *out, std::size_t count,
+               const mat3x2 &m) {
+  const __m128 row_x =
+      _mm_setr_ps(m.raw[0].x, m.raw[0].y, m.raw[0].x, m.raw[0].y);
+  const __m128 row_y =
+      _mm_setr_ps(m.raw[1].x, m.raw[1].y, m.raw[1].x, m.raw[1].y);
+  const __m128 offset =
+      _mm_setr_ps(m.raw[2].x, m.raw[2].y, m.raw[2].x, m.raw[2].y);
+
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const __m128 v = _mm_loadu_ps(reinterpret_cast<const float *>(&in[i]));
+    const __m128 xx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 yy = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+    const __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(xx, row_x), _mm_mul_ps(yy, row_y)), offset);
+    _mm_storeu_ps(reinterpret_cast<float *>(&out[i]), r);
+  }
+  transform_scalar(in + i, out + i, count - i, m);
+}
+
+// four positions at once
+__attribute__((target("avx2"))) static void
+transform_avx2(const vec2 *in, vec2 *out, std::size_t count,
+               const mat3x2 &m) {
+  const __m256 row_x = _mm256_setr_ps(m.raw[0].x, m.raw[0].y, m.raw[0].x,
+                                      m.raw[0].y, m.raw[0].x, m.raw[0].y,
+                                      m.raw[0].x, m.raw[0].y);
+  const __m256 row_y = _mm256_setr_ps(m.raw[1].x, m.raw[1].y, m.raw[1].x,
+                                      m.raw[1].y, m.raw[1].x, m.raw[1].y,
+                                      m.raw[1].x, m.raw[1].y);
+  const __m256 offset = _mm256_setr_ps(m.raw[2].x, m.raw[2].y, m.raw[2].x,
+                                       m.raw[2].y, m.raw[2].x, m.raw[2].y,
+                                       m.raw[2].x, m.raw[2].y);
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256 v =
+        _mm256_loadu_ps(reinterpret_cast<const float *>(&in[i]));
+    const __m256 xx = _mm256_moveldup_ps(v);
+    const __m256 yy = _mm256_movehdup_ps(v);
+    const __m256 r = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(xx, row_x), _mm256_mul_ps(yy, row_y)),
+        offset);
+    _mm256_storeu_ps(reinterpret_cast<float *>(&out[i]), r);
+  }
+  transform_sse2(in + i, out + i, count - i, m);
+}
+
+// positions of two vertices are transformed in one register, then put
+// back next to uv of their vertex, color is copied as is
+__attribute__((target("sse2"))) static void
+transform_vertices_sse2(const v2 *in, v2 *out, std::size_t count,
+                        const mat3x2 &m) {
+  static_assert(sizeof(v2) == 4 * sizeof(float) + sizeof(color),
+                "pos and uv of v2 must fill one register");
+  const __m128 row_x =
+      _mm_setr_ps(m.raw[0].x, m.raw[0].y, m.raw[0].x, m.raw[0].y);
+  const __m128 row_y =
+      _mm_setr_ps(m.raw[1].x, m.raw[1].y, m.raw[1].x, m.raw[1].y);
+  const __m128 offset =
+      _mm_setr_ps(m.raw[2].x, m.raw[2].y, m.raw[2].x, m.raw[2].y);
+
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    // x, y, u, v of each vertex
+    const __m128 a = _mm_loadu_ps(reinterpret_cast<const float *>(&in[i]));
+    const __m128 b =
+        _mm_loadu_ps(reinterpret_cast<const float *>(&in[i + 1]));
+    const color color_a = in[i].c;
+    const color color_b = in[i + 1].c;
+    const __m128 xx = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128 yy = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(xx, row_x), _mm_mul_ps(yy, row_y)), offset);
+    _mm_storeu_ps(reinterpret_cast<float *>(&out[i]),
+                  _mm_shuffle_ps(r, a, _MM_SHUFFLE(3, 2, 1, 0)));
+    _mm_storeu_ps(reinterpret_cast<float *>(&out[i + 1]),
+                  _mm_shuffle_ps(_mm_movehl_ps(r, r), b,
+                                 _MM_SHUFFLE(3, 2, 1, 0)));
+    out[i].c = color_a;
+    out[i + 1].c = color_b;
+  }
+  transform_vertices_scalar(in + i, out + i, count - i, m);
+}
+
+#endif // TME_X86_SIMD
+
+static transform_kernel select_kernel() {
+#ifdef TME_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return transform_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return transform_sse2;
+  }
+#endif
+  return transform_scalar;
+}
+
+static transform_kernel get_kernel() {
+  static const transform_kernel kernel = select_kernel();
+  return kernel;
+}
+
+static vertex_kernel select_vertex_kernel() {
+#ifdef TME_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    return transform_vertices_sse2;
+  }
+#endif
+  return transform_vertices_scalar;
+}
+
+void transform(const vec2 *in, vec2 *out, std::size_t count, const mat3x2 &m) {
+  get_kernel()(in, out, count, m);
+}
+
+void transform(const tri2 *in, tri2 *out, std::size_t count,
+               const mat3x2 &m) {
+  static_assert(sizeof(tri2) == 3 * sizeof(v2),
+                "all vertices of tri2 array must be placed with one stride");
+  // in and out may be null then
+  if (count == 0) {
+    return;
+  }
+  static const vertex_kernel kernel = select_vertex_kernel();
+  kernel(in[0].v, out[0].v, count * 3, m);
+}
+
+} // namespace tme
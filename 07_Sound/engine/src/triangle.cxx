@@ -6,4 +6,6 @@ tri0::tri0() : v{v0(), v0(), v0()} {}
 tri1::tri1() : v{v1(), v1(), v1()} {}
 
 tri2::tri2() : v{v2(), v2(), v2()} {}
+
+quad2::quad2() : v{v2(), v2(), v2(), v2()} {}
 } // namespace tme
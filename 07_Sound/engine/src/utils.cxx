@@ -15,42 +15,6 @@ static std::array<std::string_view, 17> event_names = {
      /// virtual console events
      "turn_off"}};
 
-vec2 operator+(const vec2 &l, const vec2 &r) {
-  vec2 result;
-  result.x = l.x + r.x;
-  result.y = l.y + r.y;
-  return result;
-}
-
-vec2 operator*(const float &f, const vec2 &v) {
-  vec2 result;
-  result.x = f * v.x;
-  result.y = f * v.y;
-  return result;
-}
-
-vec2 operator*(const vec2 &v, const mat3x2 &m) {
-  vec2 result;
-  result.x = v.x * m.raw[0].x + v.y * m.raw[1].x + m.raw[2].x;
-  result.y = v.x * m.raw[0].y + v.y * m.raw[1].y + m.raw[2].y;
-  return result;
-}
-
-mat3x2 operator*(const mat3x2 &m1, const mat3x2 &m2) {
-  mat3x2 r;
-
-  r.raw[0].x = m1.raw[0].x * m2.raw[0].x + m1.raw[0].y * m2.raw[1].x;
-  r.raw[0].y = m1.raw[0].x * m2.raw[0].y + m1.raw[0].y * m2.raw[1].y;
-  r.raw[1].x = m1.raw[1].x * m2.raw[0].x + m1.raw[1].y * m2.raw[1].x;
-  r.raw[1].y = m1.raw[1].x * m2.raw[0].y + m1.raw[1].y * m2.raw[1].y;
-  r.raw[2].x =
-      m1.raw[2].x * m2.raw[0].x + m1.raw[2].y * m2.raw[1].x + m2.raw[2].x;
-  r.raw[2].y =
-      m1.raw[2].x * m2.raw[0].y + m1.raw[2].y * m2.raw[1].y + m2.raw[2].y;
-
-  return r;
-}
-
 std::ostream &operator<<(std::ostream &stream, const event e) {
   std::uint32_t value = static_cast<std::uint32_t>(e);
   std::uint32_t minimal = static_cast<std::uint32_t>(event::left_pressed);
@@ -133,4 +97,12 @@ std::istream &operator>>(std::istream &is, tri2 &t) {
   return is;
 }
 
+std::istream &operator>>(std::istream &is, quad2 &q) {
+  is >> q.v[0];
+  is >> q.v[1];
+  is >> q.v[2];
+  is >> q.v[3];
+  return is;
+}
+
 } // namespace tme
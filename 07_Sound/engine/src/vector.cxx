@@ -1,11 +0,0 @@
-#include "engine.hxx"
-#include <array>
-#include <cassert>
-#include <cmath>
-
-namespace tme {
-
-vec2::vec2() : x(0.f), y(0.f) {}
-
-vec2::vec2(float x_, float y_) : x(x_), y(y_) {}
-} // namespace tme
@@ -12,10 +12,10 @@ public:
 
   float get_angle() const;
   vec2 get_position() const;
-  tri2 *get_tri2s() const;
+  const quad2 &get_quad2() const;
 
 protected:
-  tri2 tr[2];
+  quad2 q;
   vec2 position;
   float scale;
   float angle;
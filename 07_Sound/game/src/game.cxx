@@ -10,6 +10,7 @@
 #include <iostream>
 #include <memory>
 #include <string_view>
+#include <vector>
 /*
 tme::v0 blend(const tme::v0 &vl, const tme::v0 &vr, const float a) {
   tme::v0 r;
@@ -27,14 +28,94 @@ tme::tri0 blend(const tme::tri0 &tl, const tme::tri0 &tr, const float a) {
 }
 */
 
-int main(int /*argc*/, char * /*argv*/ []) {
+namespace game {
+
+/// tank moves one cell per key press, press during move is ignored
+class tank_game final : public tme::game_loop {
+public:
+  tank_game(tme::engine &engine_, tme::texture *texture_, float antiscale)
+      : engine(engine_), texture(texture_), q(antiscale),
+        m_movement(
+            tme::mat3x2::movement(tme::vec2(antiscale - 1, antiscale - 1))),
+        m_rotation(tme::mat3x2::rotation(0)) {}
+
+  void on_event(tme::event e) final {
+    std::cout << e << std::endl;
+    events.push_back(e);
+  }
+
+  bool update(float dt) final {
+    previous = progress;
+    for (tme::event e : events) {
+      if (e == tme::event::turn_off) {
+        return false;
+      }
+      if (progress < 1) {
+        continue;
+      }
+      switch (e) {
+      case tme::event::up_pressed:
+        start_move(tank::direction::up);
+        break;
+      case tme::event::down_pressed:
+        start_move(tank::direction::down);
+        break;
+      case tme::event::left_pressed:
+        start_move(tank::direction::left);
+        break;
+      case tme::event::right_pressed:
+        start_move(tank::direction::right);
+        break;
+      default:
+        break;
+      }
+    }
+    events.clear();
+    // one cell per second
+    progress = std::min(1.f, progress + dt);
+    return true;
+  }
+
+  void render(float alpha) final {
+    const float p = previous + (progress - previous) * alpha;
+    const tme::mat3x2 m = m_rotation * tme::mat3x2::rotation(p * move.second) *
+                          m_movement * tme::mat3x2::movement(p * move.first);
+    engine.begin_batch();
+    engine.submit(q.get_quad2(), texture, m);
+    engine.flush_batch();
+  }
+
+private:
+  void start_move(tank::direction d) {
+    m_movement = m_movement * tme::mat3x2::movement(move.first);
+    m_rotation = m_rotation * tme::mat3x2::rotation(move.second);
+    move = q.move(d);
+    // finished move is now part of matrices, so new one starts from 0
+    previous = 0;
+    progress = 0;
+  }
+
+  tme::engine &engine;
+  tme::texture *texture;
+  tank q;
+  tme::mat3x2 m_movement;
+  tme::mat3x2 m_rotation;
+  std::pair<tme::vec2, float> move;
+  // part of current move done at previous and current update
+  float previous = 1;
+  float progress = 1;
+  std::vector<tme::event> events;
+};
+
+} // namespace game
+
+int main(int argc, char *argv[]) {
 
   std::unique_ptr<tme::engine, void (*)(tme::engine *)> engine(
       tme::create_engine(), tme::destroy_engine);
 
-  float counter = 1;
-  engine->count_to_1(&counter, 10);
-  const std::string error = engine->initialize("");
+  // optional engine config, see engine::initialize
+  const std::string error = engine->initialize(argc > 1 ? argv[1] : "");
   if (!error.empty()) {
     std::cerr << error << std::endl;
     return EXIT_FAILURE;
@@ -53,71 +134,20 @@ int main(int /*argc*/, char * /*argv*/ []) {
   file >> scale;
   float antiscale = 1.0f / static_cast<float>(scale);
 
-  game::tank q(antiscale);
-
-  tme::mat3x2 m_movement =
-      tme::mat3x2::movement(tme::vec2(antiscale - 1, antiscale - 1));
-  tme::mat3x2 m_rotation = tme::mat3x2::rotation(0);
-  std::pair<tme::vec2, float> move;
-
-  bool continue_loop = true;
-
-  while (continue_loop) {
-    tme::event event;
-
-    while (engine->read_input(event)) {
-
-      if (counter < 1)
-        continue;
-
-      std::cout << event << std::endl;
-
-      switch (event) {
-
-      case tme::event::turn_off:
-        continue_loop = false;
-        break;
-
-      case tme::event::up_pressed:
-        counter = 0;
-        m_movement = m_movement * tme::mat3x2::movement(move.first);
-        m_rotation = m_rotation * tme::mat3x2::rotation(move.second);
-        move = q.move(game::tank::direction::up);
-        break;
-      case tme::event::down_pressed:
-        counter = 0;
-        m_movement = m_movement * tme::mat3x2::movement(move.first);
-        m_rotation = m_rotation * tme::mat3x2::rotation(move.second);
-        move = q.move(game::tank::direction::down);
-        break;
-      case tme::event::left_pressed:
-        counter = 0;
-        m_movement = m_movement * tme::mat3x2::movement(move.first);
-        m_rotation = m_rotation * tme::mat3x2::rotation(move.second);
-        move = q.move(game::tank::direction::left);
-        break;
-      case tme::event::right_pressed:
-        counter = 0;
-        m_movement = m_movement * tme::mat3x2::movement(move.first);
-        m_rotation = m_rotation * tme::mat3x2::rotation(move.second);
-        move = q.move(game::tank::direction::right);
-        break;
-      default:
-        break;
-      }
-    }
-
-    (q.get_angle());
-    tme::tri2 *quad_triangles = q.get_tri2s();
-    engine->render(quad_triangles[0], texture,
-                   m_rotation * tme::mat3x2::rotation(counter * move.second),
-                   m_movement * tme::mat3x2::movement(counter * move.first));
-    engine->render(quad_triangles[1], texture,
-                   m_rotation * tme::mat3x2::rotation(counter * move.second),
-                   m_movement * tme::mat3x2::movement(counter * move.first));
-
-    engine->swap_buffers();
-  }
+  game::tank_game game(*engine, texture, antiscale);
+  engine->run(game);
+
+  // soak tests read these lines from the log
+  const tme::frame_timing timing = engine->get_frame_timing();
+  auto print = [](std::string_view name, const tme::timing_percentiles &p) {
+    std::cout << name << " ms p50 " << p.p50_ms << " p95 " << p.p95_ms
+              << " p99 " << p.p99_ms << " max " << p.max_ms << '\n';
+  };
+  std::cout << "frames " << timing.frames << " hitches " << timing.hitches
+            << '\n';
+  print("cpu", timing.cpu);
+  print("interval", timing.interval);
+  print("input latency", timing.input_latency);
 
   engine->uninitialize();
 
@@ -26,23 +26,20 @@ const std::pair<vec2, float> quad::change_pos(const float &x, const float &y,
 float quad::get_angle() const { return angle; }
 
 vec2 quad::get_position() const { return position; }
-tri2 *quad::get_tri2s() const { return const_cast<tri2 *>(tr); }
+const quad2 &quad::get_quad2() const { return q; }
 
 void quad::fill_vert_coord() {
-  tr[0].v[0].pos = vec2(-scale, scale);
-  tr[0].v[1].pos = vec2(scale, -scale);
-  tr[0].v[2].pos = vec2(-scale, -scale);
-
-  tr[1].v[0].pos = vec2(-scale, scale);
-  tr[1].v[1].pos = vec2(scale, scale);
-  tr[1].v[2].pos = vec2(scale, -scale);
+  q.v[0].pos = vec2(-scale, scale);
+  q.v[1].pos = vec2(scale, scale);
+  q.v[2].pos = vec2(scale, -scale);
+  q.v[3].pos = vec2(-scale, -scale);
 }
 
 void quad::fill_text_coord() {
-  tr[0].v[0].uv = tr[1].v[0].uv = vec2(0.0f, 0.0f);
-  tr[1].v[1].uv = vec2(1.0f, 0.0f);
-  tr[0].v[1].uv = tr[1].v[2].uv = vec2(1.0f, 1.0f);
-  tr[0].v[2].uv = vec2(0.0f, 1.0f);
+  q.v[0].uv = vec2(0.0f, 0.0f);
+  q.v[1].uv = vec2(1.0f, 0.0f);
+  q.v[2].uv = vec2(1.0f, 1.0f);
+  q.v[3].uv = vec2(0.0f, 1.0f);
 }
 
 } // namespace game
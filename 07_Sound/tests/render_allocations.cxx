@@ -0,0 +1,120 @@
+// render loop must not touch heap once its buffers have grown: every kind
+// of draw is issued for some frames, then frames are repeated while global
+// operator new counts allocations of all threads
+#include "engine.hxx"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+static std::atomic<std::size_t> allocations{0};
+
+// executable replaces operator new for libengine too
+void *operator new(std::size_t size) {
+  ++allocations;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+static tme::v2 vertex(float x, float y, float u, float v) {
+  tme::v2 result;
+  result.pos = tme::vec2(x, y);
+  result.uv = tme::vec2(u, v);
+  return result;
+}
+
+static void render_frame(tme::engine &e, tme::texture *t, tme::mesh *m,
+                         const std::vector<tme::instance> &instances,
+                         std::uint32_t frame) {
+  const tme::mat3x2 spin = tme::mat3x2::rotation(0.01f * frame);
+  const tme::mat3x2 move = tme::mat3x2::movement(tme::vec2(0.1f, 0.f));
+
+  tme::tri0 t0;
+  t0.v[1].pos = tme::vec2(1.f, 0.f);
+  t0.v[2].pos = tme::vec2(0.f, 1.f);
+  e.render(t0, tme::color(1.f, 0.f, 0.f, 1.f));
+  tme::tri1 t1;
+  t1.v[1].pos = tme::vec2(-1.f, 0.f);
+  t1.v[2].pos = tme::vec2(0.f, -1.f);
+  e.render(t1);
+
+  tme::tri2 t2;
+  t2.v[0] = vertex(0.f, 0.f, 0.f, 0.f);
+  t2.v[1] = vertex(0.5f, 0.f, 1.f, 0.f);
+  t2.v[2] = vertex(0.f, 0.5f, 0.f, 1.f);
+  e.render(t2, t);
+  e.render(t2, t, spin);
+  e.render(t2, t, spin, move);
+  e.render(m, t, spin);
+  e.render_instanced(m, t, instances.data(), instances.size());
+
+  tme::quad2 q;
+  q.v[0] = vertex(-0.1f, -0.1f, 0.f, 1.f);
+  q.v[1] = vertex(0.1f, -0.1f, 1.f, 1.f);
+  q.v[2] = vertex(0.1f, 0.1f, 1.f, 0.f);
+  q.v[3] = vertex(-0.1f, 0.1f, 0.f, 0.f);
+  e.begin_batch();
+  for (std::uint32_t i = 0; i < 500; ++i) {
+    const tme::mat3x2 m_i =
+        spin * tme::mat3x2::movement(tme::vec2(0.002f * i, 0.f));
+    e.submit(q, t, m_i);
+    e.submit(t2, t, m_i);
+  }
+  e.flush_batch();
+
+  for (std::uint32_t i = 0; i < 200; ++i) {
+    e.enqueue(q, t, tme::mat3x2::movement(tme::vec2(0.f, 0.004f * i)),
+              static_cast<std::uint8_t>(i % 3), 0.001f * i);
+  }
+  e.swap_buffers();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "usage: test_render_allocations config png\n";
+    return EXIT_FAILURE;
+  }
+  std::unique_ptr<tme::engine, void (*)(tme::engine *)> engine(
+      tme::create_engine(), tme::destroy_engine);
+  const std::string error = engine->initialize(argv[1]);
+  if (!error.empty()) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  tme::texture *texture = engine->create_texture(argv[2]);
+  const std::vector<tme::v2> vertices = {
+      vertex(0.f, 0.f, 0.f, 0.f), vertex(0.1f, 0.f, 1.f, 0.f),
+      vertex(0.1f, 0.1f, 1.f, 1.f), vertex(0.f, 0.1f, 0.f, 1.f)};
+  tme::mesh *mesh = engine->create_mesh(vertices, {0, 1, 2, 0, 2, 3});
+  std::vector<tme::instance> instances(64);
+  for (std::size_t i = 0; i < instances.size(); ++i) {
+    instances[i].m =
+        tme::mat3x2::movement(tme::vec2(0.01f * static_cast<float>(i), 0.f));
+  }
+
+  // buffers grow to their steady size
+  std::uint32_t frame = 0;
+  for (; frame < 30; ++frame) {
+    render_frame(*engine, texture, mesh, instances, frame);
+  }
+  const std::size_t before = allocations;
+  for (; frame < 330; ++frame) {
+    render_frame(*engine, texture, mesh, instances, frame);
+  }
+  const std::size_t per_run = allocations - before;
+
+  engine->destroy_mesh(mesh);
+  engine->destroy_texture(texture);
+  engine->uninitialize();
+
+  std::cout << "allocations in 300 frames: " << per_run << '\n';
+  return per_run == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
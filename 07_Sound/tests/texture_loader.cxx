@@ -0,0 +1,269 @@
+// async texture loader on null gl: images upload in order of loading
+// within byte budget per frame, rest carries over to next frames;
+// cancelled textures, before or after their decode, are never uploaded
+// and give back their unpack buffers; everything runs once decoding into
+// memory and once into pixel unpack buffers faked on cpu
+#include "gl_init.hxx"
+#include "lodepng.h"
+#include "texture_loader.hxx"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using tme::gl;
+
+// fake pixel unpack buffers, touched by gl thread and, through mapped
+// pointers, by loader workers
+static std::unordered_map<GLuint, std::vector<unsigned char>> storage;
+static GLuint last_buffer = 0;
+static GLuint bound_unpack = 0;
+static std::size_t maps = 0;
+static std::size_t unmaps = 0;
+// widths of level 0 images given to glTexImage2D, in order
+static std::vector<std::uint32_t> uploaded;
+static bool pixels_match = true;
+
+static int failures = 0;
+static const char *mode = "";
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "failed (" << mode << "): " << what << '\n';
+    ++failures;
+  }
+}
+
+// every image has its own width, pixels follow from it
+static unsigned char expected_byte(std::uint32_t width, std::size_t i) {
+  return static_cast<unsigned char>((i * 31 + width) & 0xff);
+}
+
+static std::string write_png(std::uint32_t width, std::uint32_t height) {
+  std::vector<unsigned char> rgba(std::size_t{4} * width * height);
+  for (std::size_t i = 0; i < rgba.size(); ++i) {
+    rgba[i] = expected_byte(width, i);
+  }
+  const std::string path = "test_loader_" + std::to_string(width) + ".png";
+  if (lodepng::encode(path, rgba, width, height) != 0) {
+    std::cerr << "can't write " << path << '\n';
+    std::exit(EXIT_FAILURE);
+  }
+  return path;
+}
+
+static void APIENTRY gen_buffers(GLsizei n, GLuint *names) {
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = ++last_buffer;
+  }
+}
+static void APIENTRY delete_buffers(GLsizei n, const GLuint *names) {
+  for (GLsizei i = 0; i < n; ++i) {
+    storage.erase(names[i]);
+  }
+}
+static void APIENTRY bind_buffer(GLenum target, GLuint name) {
+  if (target == GL_PIXEL_UNPACK_BUFFER) {
+    bound_unpack = name;
+  }
+}
+static void APIENTRY buffer_data(GLenum target, GLsizeiptr size,
+                                 const void *, GLenum) {
+  if (target == GL_PIXEL_UNPACK_BUFFER) {
+    storage[bound_unpack].assign(static_cast<std::size_t>(size), 0);
+  }
+}
+static void *APIENTRY map_buffer(GLenum, GLenum) {
+  ++maps;
+  return storage[bound_unpack].data();
+}
+static GLboolean APIENTRY unmap_buffer(GLenum) {
+  ++unmaps;
+  return GL_TRUE;
+}
+static void APIENTRY tex_image(GLenum, GLint level, GLint, GLsizei w,
+                               GLsizei h, GLint, GLenum, GLenum,
+                               const void *pixels) {
+  if (level != 0 || w == 1) {
+    // mip levels and placeholders
+    return;
+  }
+  const std::uint32_t width = static_cast<std::uint32_t>(w);
+  uploaded.push_back(width);
+  const unsigned char *rgba = static_cast<const unsigned char *>(pixels);
+  if (bound_unpack != 0) {
+    // pixels is offset into bound buffer
+    rgba = storage[bound_unpack].data() +
+           reinterpret_cast<std::uintptr_t>(pixels);
+  }
+  for (std::size_t i = 0; i < std::size_t{4} * width * h; ++i) {
+    if (rgba[i] != expected_byte(width, i)) {
+      pixels_match = false;
+      return;
+    }
+  }
+}
+
+/// wait until workers have nothing to decode, however slow host is
+static void wait_for_workers(const tme::texture_loader &loader) {
+  const auto start = std::chrono::steady_clock::now();
+  while (loader.get_decoding() != 0 &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(30)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  check(loader.get_decoding() == 0, "workers finish decoding");
+}
+
+/// one frame of game: upload, then let workers finish what upload gave
+/// them; return count of images uploaded
+static std::size_t frame(tme::texture_loader &loader, std::size_t budget) {
+  const std::size_t before = uploaded.size();
+  loader.upload(budget);
+  wait_for_workers(loader);
+  return uploaded.size() - before;
+}
+
+/// run frames until nothing is loading, return most images of one frame
+static std::size_t drain(tme::texture_loader &loader, std::size_t budget) {
+  std::size_t most = 0;
+  for (int i = 0; i < 2000 && loader.get_loading() != 0; ++i) {
+    most = std::max(most, frame(loader, budget));
+  }
+  check(loader.get_loading() == 0, "loader drains");
+  return most;
+}
+
+static void test_order_and_budget() {
+  uploaded.clear();
+  const std::size_t maps_before = maps;
+  const std::size_t unmaps_before = unmaps;
+  tme::texture_loader loader(1);
+  std::vector<tme::texture_gl_es20 *> textures;
+  std::vector<std::uint32_t> widths;
+  for (std::uint32_t width = 16; width < 22; ++width) {
+    textures.push_back(
+        loader.load(write_png(width, 16), tme::texture_options()));
+    widths.push_back(width);
+  }
+  check(loader.get_loading() == textures.size(), "all loading");
+  wait_for_workers(loader);
+
+  // 16x16 image is 1024 bytes, so budget fits first image of frame
+  // and part of second one
+  const std::size_t budget = 4 * 24 * 16 + 1;
+  std::size_t most = frame(loader, budget);
+  // loaded while earlier images still wait for their frame
+  for (std::uint32_t width = 22; width < 25; ++width) {
+    textures.push_back(
+        loader.load(write_png(width, 16), tme::texture_options()));
+    widths.push_back(width);
+  }
+  wait_for_workers(loader);
+  most = std::max(most, drain(loader, budget));
+  check(most == 2, "budget is crossed by one image per frame");
+  check(uploaded == widths, "upload follows load order");
+  check(pixels_match, "uploaded pixels are decoded png");
+  for (std::size_t i = 0; i < textures.size(); ++i) {
+    check(textures[i]->get_status() == tme::texture_status::ready &&
+              textures[i]->get_width() == widths[i],
+          "texture is ready with its size");
+    delete textures[i];
+  }
+  check(maps - maps_before == unmaps - unmaps_before,
+        "every mapped buffer is unmapped");
+}
+
+static void test_cancel_before_decode(bool unpack) {
+  uploaded.clear();
+  const std::size_t maps_before = maps;
+  const std::size_t unmaps_before = unmaps;
+  tme::texture_loader loader(1);
+  tme::texture_options mipmapped;
+  mipmapped.mipmaps = true;
+  const std::string busy_path = write_png(1024, 1024);
+  const std::string path = write_png(30, 16);
+  tme::texture_gl_es20 *busy = nullptr;
+  tme::texture_gl_es20 *cancelled = nullptr;
+  if (unpack) {
+    // size of image is read, then its buffer is mapped while only worker
+    // is busy with decode and mips of big image
+    cancelled = loader.load(path, tme::texture_options());
+    wait_for_workers(loader);
+    busy = loader.load(busy_path, mipmapped);
+    loader.upload(1);
+    check(maps - maps_before == 1, "buffer is mapped before decode");
+  } else {
+    busy = loader.load(busy_path, mipmapped);
+    cancelled = loader.load(path, tme::texture_options());
+  }
+  loader.forget(cancelled);
+  check(loader.get_loading() == 1, "cancelled texture is not loading");
+
+  drain(loader, 1);
+  check(uploaded == std::vector<std::uint32_t>{1024},
+        "only texture not cancelled is uploaded");
+  check(busy->get_status() == tme::texture_status::ready,
+        "texture not cancelled is ready");
+  check(cancelled->get_status() == tme::texture_status::loading,
+        "cancelled texture is left alone");
+  check(maps - maps_before == unmaps - unmaps_before,
+        "buffer of cancelled texture is unmapped");
+  delete busy;
+  delete cancelled;
+}
+
+static void test_cancel_after_decode(bool unpack) {
+  uploaded.clear();
+  const std::size_t maps_before = maps;
+  const std::size_t unmaps_before = unmaps;
+  tme::texture_loader loader(1);
+  tme::texture_gl_es20 *cancelled =
+      loader.load(write_png(40, 16), tme::texture_options());
+  tme::texture_gl_es20 *kept =
+      loader.load(write_png(41, 16), tme::texture_options());
+  wait_for_workers(loader);
+  if (unpack) {
+    // map buffers of both, then let workers decode into them
+    check(frame(loader, 1 << 20) == 0, "sizes are read first");
+    check(maps - maps_before == 2, "buffers are mapped");
+  }
+  loader.forget(cancelled);
+
+  drain(loader, 1 << 20);
+  check(uploaded == std::vector<std::uint32_t>{41},
+        "decoded cancelled texture is dropped");
+  check(pixels_match, "uploaded pixels are decoded png");
+  check(cancelled->get_status() == tme::texture_status::loading,
+        "cancelled texture is left alone");
+  check(maps - maps_before == unmaps - unmaps_before,
+        "buffer of cancelled texture is unmapped");
+  delete kept;
+  delete cancelled;
+}
+
+int main() {
+  gl::init_null();
+  gl::glGenBuffers = gen_buffers;
+  gl::glDeleteBuffers = delete_buffers;
+  gl::glBindBuffer = bind_buffer;
+  gl::glBufferData = buffer_data;
+  gl::glMapBuffer = map_buffer;
+  gl::glUnmapBuffer = unmap_buffer;
+  gl::glTexImage2D = tex_image;
+
+  for (const bool unpack : {false, true}) {
+    // loader reads it once, when created
+    gl::has_pixel_buffer_objects = unpack;
+    mode = unpack ? "unpack buffers" : "memory";
+    test_order_and_budget();
+    test_cancel_before_decode(unpack);
+    test_cancel_after_decode(unpack);
+  }
+  if (failures == 0) {
+    std::cout << "texture loader tests passed\n";
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}